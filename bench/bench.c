@@ -0,0 +1,408 @@
+// Times the lib/ operations the solver leans on, one at a time, across a
+// range of sizes.  Prints a line of CSV per operation and size:
+//
+//     operation,size,ns_per_op,allocs_per_op
+//
+// Allocations are counted by wrapping malloc, calloc and realloc at link
+// time (see the bench target in the Makefile), so only calls made from
+// this program and lib/ are seen.  Sizes run from 1e3 up by tens to the
+// largest one given on the command line, 1e7 by default.  The queues are
+// timed enqueueing and dequeueing by turns, as a search does, so their
+// rows count each of either as one op.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../lib/graph.h"
+#include "../lib/list.h"
+#include "../lib/map.h"
+#include "../lib/path.h"
+#include "../lib/pqueue.h"
+
+enum { SMALLEST_SIZE = 1000, LARGEST_SIZE = 10000000 };
+
+// Edges out of each node of the graphs timed
+enum { GRAPH_DEGREE = 4 };
+
+// Paths read off each path tree timed
+enum { TREE_QUERIES = 100 };
+
+struct timing {
+	struct timespec start;
+	size_t allocations;
+};
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t count, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+
+static void start_timing(struct timing *t);
+static void report(const char *operation, size_t size, size_t ops,
+		const struct timing *t);
+static size_t next_random(size_t *state);
+
+static bool bench_list(size_t n);
+static bool bench_map(size_t n);
+static bool bench_map_u64(size_t n);
+static bool bench_pqueue(size_t n, enum pqueue_type type, const char *name);
+static bool bench_graph(size_t n, bool in_arena);
+static bool bench_graph_destroy(size_t n, bool in_arena);
+static bool bench_path_tree(size_t n);
+static graph *build_graph(size_t n, bool in_arena, const char *name);
+static void count_neighbor(const void *data);
+
+static size_t allocations;
+static size_t neighbors_seen;
+
+// Keeps results alive, so that nothing being timed is optimized out
+static volatile size_t sink;
+
+int main(int argc, char *argv[])
+{
+	size_t largest = LARGEST_SIZE;
+	if (argc > 2) {
+		fprintf(stderr, "Usage: %s [largest size]\n", argv[0]);
+		return 1;
+	} else if (argc == 2) {
+		char *end;
+		largest = strtoul(argv[1], &end, 10);
+		if (*end || largest < SMALLEST_SIZE) {
+			fprintf(stderr, "Error: largest size must be at least %d\n",
+					SMALLEST_SIZE);
+			return 1;
+		}
+	}
+
+	printf("operation,size,ns_per_op,allocs_per_op\n");
+	for (size_t n = SMALLEST_SIZE; n <= largest; n *= 10) {
+		if (!bench_list(n) || !bench_map(n) || !bench_map_u64(n)
+				|| !bench_pqueue(n, MIN_PQUEUE, "pqueue_search/heap")
+				|| !bench_pqueue(n, BUCKET_PQUEUE, "pqueue_search/bucket")
+				|| !bench_graph(n, false) || !bench_graph(n, true)
+				|| !bench_graph_destroy(n, false)
+				|| !bench_graph_destroy(n, true)
+				|| !bench_path_tree(n)) {
+			fprintf(stderr, "Error: failed at size %zu\n", n);
+			return 3;
+		}
+		fflush(stdout);
+	}
+
+	return 0;
+}
+
+void *__wrap_malloc(size_t size)
+{
+	allocations++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+	allocations++;
+	return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	allocations++;
+	return __real_realloc(ptr, size);
+}
+
+static void start_timing(struct timing *t)
+{
+	t->allocations = allocations;
+	clock_gettime(CLOCK_MONOTONIC, &t->start);
+}
+
+static void report(const char *operation, size_t size, size_t ops,
+		const struct timing *t)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double ns = (end.tv_sec - t->start.tv_sec) * 1e9
+		+ (end.tv_nsec - t->start.tv_nsec);
+	printf("%s,%zu,%.2f,%.3f\n", operation, size, ns / ops,
+			(double)(allocations - t->allocations) / ops);
+}
+
+// xorshift64, so that every run times the same sequence
+static size_t next_random(size_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static bool bench_list(size_t n)
+{
+	list *l = list_create(NULL);
+	if (!l) {
+		return false;
+	}
+
+	struct timing t;
+	start_timing(&t);
+	for (size_t i=0; i < n; ++i) {
+		list_prepend(l, (void *)(i + 1));
+	}
+	report("list_prepend", n, n, &t);
+
+	bool filled = list_size(l) == n;
+	list_destroy(l);
+	return filled;
+}
+
+static bool bench_map(size_t n)
+{
+	// Keys are written out before the clock starts
+	enum { KEY_SIZE = 24 };
+	char *keys = malloc(n * KEY_SIZE);
+	map *m = map_create();
+	if (!keys || !m) {
+		free(keys);
+		map_destroy(m);
+		return false;
+	}
+
+	for (size_t i=0; i < n; ++i) {
+		snprintf(keys + i * KEY_SIZE, KEY_SIZE, "key%zu", i);
+	}
+
+	struct timing t;
+	start_timing(&t);
+	for (size_t i=0; i < n; ++i) {
+		map_set(m, keys + i * KEY_SIZE, (void *)(i + 1));
+	}
+	report("map_set", n, n, &t);
+
+	// Looked up in a scattered order, as a search would
+	size_t state = 88172645463325252u;
+	size_t found = 0;
+	start_timing(&t);
+	for (size_t i=0; i < n; ++i) {
+		found += (size_t)map_get(m, keys + next_random(&state) % n * KEY_SIZE);
+	}
+	report("map_get", n, n, &t);
+	sink = found;
+
+	bool filled = map_size(m) == n;
+	map_destroy(m);
+	free(keys);
+	return filled;
+}
+
+static bool bench_map_u64(size_t n)
+{
+	map_u64 *m = map_u64_create();
+	if (!m) {
+		return false;
+	}
+
+	// Keys are spread out like node addresses
+	struct timing t;
+	start_timing(&t);
+	for (size_t i=0; i < n; ++i) {
+		map_u64_set(m, i * 48, (void *)(i + 1));
+	}
+	report("map_u64_set", n, n, &t);
+
+	size_t state = 88172645463325252u;
+	size_t found = 0;
+	start_timing(&t);
+	for (size_t i=0; i < n; ++i) {
+		found += (size_t)map_u64_get(m, next_random(&state) % n * 48);
+	}
+	report("map_u64_get", n, n, &t);
+	sink = found;
+
+	bool filled = map_u64_size(m) == n;
+	map_u64_destroy(m);
+	return filled;
+}
+
+static bool bench_pqueue(size_t n, enum pqueue_type type, const char *name)
+{
+	pqueue *pq = pqueue_create(type);
+	if (!pq) {
+		return false;
+	}
+
+	// Used the way a search through a grid uses it: each item dequeued
+	// queues up to two more a few half steps further on, so priorities
+	// never drop below the last one dequeued and the queue holds a
+	// frontier about as wide as the square root of n
+	size_t frontier = 1;
+	while (frontier * frontier < n) {
+		frontier++;
+	}
+
+	size_t state = 88172645463325252u;
+	size_t queued = 1;
+	size_t dequeued = 0;
+	double priority;
+	struct timing t;
+	start_timing(&t);
+	bool ok = pqueue_enqueue(pq, 0, (void *)queued);
+	while (ok && pqueue_dequeue(pq, &priority)) {
+		dequeued++;
+		size_t more = queued - dequeued < frontier ? 2 : 1;
+		for (size_t k=0; ok && k < more && queued < n; ++k) {
+			queued++;
+			ok = pqueue_enqueue(pq,
+					priority + (1 + next_random(&state) % 4) * 0.5,
+					(void *)queued);
+		}
+	}
+	report(name, n, 2 * n, &t);
+
+	// Otherwise the bucket row would be timing the heap
+	bool bucketed = type != BUCKET_PQUEUE || pqueue_is_bucketed(pq);
+	if (!bucketed) {
+		fprintf(stderr, "Error: %s moved over to the heap\n", name);
+	}
+
+	pqueue_destroy(pq);
+	return ok && bucketed && dequeued == n;
+}
+
+static bool bench_graph(size_t n, bool in_arena)
+{
+	graph *g = build_graph(n, in_arena,
+			in_arena ? "graph_add_edge/arena" : "graph_add_edge");
+	if (!g) {
+		return false;
+	}
+
+	neighbors_seen = 0;
+	struct timing t;
+	start_timing(&t);
+	for (size_t i=0; i < n / GRAPH_DEGREE; ++i) {
+		graph_iterate_neighbors(g, (void *)(i + 1), count_neighbor);
+	}
+	report(in_arena ? "graph_iterate_neighbors/arena"
+			: "graph_iterate_neighbors", n, n, &t);
+	bool linked = neighbors_seen == n;
+	if (in_arena) {
+		graph_destroy(g);
+		return linked;
+	}
+
+	if (!graph_freeze(g)) {
+		graph_destroy(g);
+		return false;
+	}
+
+	neighbors_seen = 0;
+	start_timing(&t);
+	for (size_t i=0; i < n / GRAPH_DEGREE; ++i) {
+		graph_iterate_neighbors(g, (void *)(i + 1), count_neighbor);
+	}
+	report("graph_iterate_neighbors/frozen", n, n, &t);
+	bool frozen = neighbors_seen == n;
+
+	graph_destroy(g);
+	return linked && frozen;
+}
+
+// Tearing down the linked form, per edge
+static bool bench_graph_destroy(size_t n, bool in_arena)
+{
+	graph *g = build_graph(n, in_arena, NULL);
+	if (!g) {
+		return false;
+	}
+
+	struct timing t;
+	start_timing(&t);
+	graph_destroy(g);
+	report(in_arena ? "graph_destroy/arena" : "graph_destroy", n, n, &t);
+
+	return true;
+}
+
+// Searches a frozen graph out from one node, then reads paths to random
+// ends off the tree
+static bool bench_path_tree(size_t n)
+{
+	graph *g = build_graph(n, false, NULL);
+	if (!g || !graph_freeze(g)) {
+		graph_destroy(g);
+		return false;
+	}
+
+	size_t nodes = n / GRAPH_DEGREE;
+	void *start = (void *)1;
+	struct timing t;
+	start_timing(&t);
+	path_tree *tree = path_tree_create(g, start);
+	report("path_tree_create", n, nodes, &t);
+	if (!tree) {
+		graph_destroy(g);
+		return false;
+	}
+
+	size_t state = 88172645463325252u;
+	size_t hops = 0;
+	bool found = true;
+	start_timing(&t);
+	for (size_t q=0; found && q < TREE_QUERIES; ++q) {
+		list *path = path_tree_path_to(tree,
+				(void *)(next_random(&state) % nodes + 1));
+		found = path != NULL;
+		hops += list_size(path);
+		list_destroy(path);
+	}
+	report("path_tree_path_to", n, TREE_QUERIES, &t);
+	sink = hops;
+
+	path_tree_destroy(tree);
+	graph_destroy(g);
+	return found;
+}
+
+// n edges, GRAPH_DEGREE out of each node, weighing 1 to 3; times adding
+// the edges as name, if given
+static graph *build_graph(size_t n, bool in_arena, const char *name)
+{
+	size_t nodes = n / GRAPH_DEGREE;
+	graph *g = in_arena ? graph_create_arena(GRAPH_PTRCMP, NULL)
+		: graph_create(GRAPH_PTRCMP, NULL);
+	if (!g) {
+		return NULL;
+	}
+
+	for (size_t i=0; i < nodes; ++i) {
+		graph_add_node(g, (void *)(i + 1));
+	}
+
+	struct timing t;
+	start_timing(&t);
+	for (size_t i=0; i < n; ++i) {
+		size_t from = i / GRAPH_DEGREE;
+		size_t to = (from + 1 + i % GRAPH_DEGREE * (nodes / GRAPH_DEGREE))
+			% nodes;
+		if (!graph_add_edge(g, (void *)(from + 1), (void *)(to + 1),
+					1 + i % 3)) {
+			graph_destroy(g);
+			return NULL;
+		}
+	}
+	if (name) {
+		report(name, n, n, &t);
+	}
+
+	return g;
+}
+
+static void count_neighbor(const void *data)
+{
+	(void)data;
+	neighbors_seen++;
+}
@@ -0,0 +1,318 @@
+// Writes a maze of about the given number of cells to stdout, the same
+// maze every time for the same kind, size and seed:
+//
+//     perfect     corridors a cell wide with exactly one way between any
+//                 two points, carved by a depth-first walk
+//     caves       open caverns grown from noise, with a way dug through
+//     terrain     caves flooded with lakes of water '~' and strewn with
+//                 doors '+' and '/', for maze -dw
+//     unsolvable  a perfect maze with the finish walled in
+//     unbounded   a perfect maze with a gap in its outer wall
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { SMALLEST_SIDE = 5 };
+
+// Everything a kind of maze is carved into
+struct canvas {
+	char *cells;
+	size_t width;
+	size_t height;
+	uint64_t random;
+};
+
+static uint64_t next_random(struct canvas *c);
+static size_t pick(struct canvas *c, size_t count);
+
+static bool carve_perfect(struct canvas *c);
+static bool grow_caves(struct canvas *c);
+static void dig_through(struct canvas *c, size_t from, size_t to);
+static bool flood_terrain(struct canvas *c);
+static void wall_in(struct canvas *c, size_t id);
+static void seal_border(struct canvas *c);
+static bool write_maze(const struct canvas *c, FILE *out);
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3 || argc > 4) {
+		fprintf(stderr, "Usage: %s perfect|caves|terrain|unsolvable|unbounded"
+				" cells [seed]\n", argv[0]);
+		return 1;
+	}
+
+	// Sizes read better as 1e6 than 1000000, so either will do
+	char *end;
+	double cells = strtod(argv[2], &end);
+	if (*end || !(cells >= 0) || cells > 1e9) {
+		fprintf(stderr, "Error: cells must be a number up to 1e9\n");
+		return 1;
+	}
+	unsigned long long seed = 1;
+	if (argc == 4) {
+		seed = strtoull(argv[3], &end, 10);
+		if (*end) {
+			fprintf(stderr, "Error: seed must be a number\n");
+			return 1;
+		}
+	}
+
+	// Square, with odd sides so that a perfect maze's rooms and walls
+	// alternate right out to the border
+	size_t side = (size_t)ceil(sqrt(cells)) | 1;
+	if (side < SMALLEST_SIDE) {
+		side = SMALLEST_SIDE;
+	}
+
+	struct canvas c = {
+		.cells = malloc(side * side),
+		.width = side,
+		.height = side,
+		// xorshift must not start at 0, and nearby seeds should still
+		// give unrelated mazes
+		.random = (seed + 1) * 0x9e3779b97f4a7c15u
+	};
+	if (!c.cells) {
+		fprintf(stderr, "Memory allocation error\n");
+		return 3;
+	}
+
+	const char *kind = argv[1];
+	size_t start = c.width + 1;
+	size_t finish = c.width * (c.height - 1) - 2;
+	bool made;
+	if (!strcmp(kind, "perfect") || !strcmp(kind, "unsolvable")
+			|| !strcmp(kind, "unbounded")) {
+		made = carve_perfect(&c);
+	} else if (!strcmp(kind, "caves") || !strcmp(kind, "terrain")) {
+		made = grow_caves(&c);
+		if (made) {
+			dig_through(&c, start, finish);
+		}
+		if (made && !strcmp(kind, "terrain")) {
+			made = flood_terrain(&c);
+		}
+	} else {
+		fprintf(stderr, "Error: unknown kind of maze: %s\n", kind);
+		free(c.cells);
+		return 1;
+	}
+	if (!made) {
+		fprintf(stderr, "Memory allocation error\n");
+		free(c.cells);
+		return 3;
+	}
+
+	c.cells[start] = '@';
+	c.cells[finish] = '>';
+	if (!strcmp(kind, "unsolvable")) {
+		wall_in(&c, finish);
+	} else if (!strcmp(kind, "unbounded")) {
+		// Row 1 is always open next to the border
+		c.cells[c.width] = ' ';
+	}
+
+	bool written = write_maze(&c, stdout);
+	free(c.cells);
+	return written ? 0 : 2;
+}
+
+// xorshift64
+static uint64_t next_random(struct canvas *c)
+{
+	c->random ^= c->random << 13;
+	c->random ^= c->random >> 7;
+	c->random ^= c->random << 17;
+	return c->random;
+}
+
+// A number below count
+static size_t pick(struct canvas *c, size_t count)
+{
+	return next_random(c) % count;
+}
+
+// Rooms sit at odd rows and columns; the walk knocks through the wall
+// between a room and an unvisited neighbor, and backs up when it has none
+static bool carve_perfect(struct canvas *c)
+{
+	memset(c->cells, '#', c->width * c->height);
+
+	// Every index fits in 32 bits, which halves the stack
+	size_t rooms = (c->width / 2) * (c->height / 2);
+	uint32_t *stack = malloc(rooms * sizeof(*stack));
+	if (!stack) {
+		return false;
+	}
+
+	size_t depth = 0;
+	stack[depth++] = c->width + 1;
+	c->cells[c->width + 1] = ' ';
+	ptrdiff_t steps[4] = { 2, -2, 2 * (ptrdiff_t)c->width,
+		-2 * (ptrdiff_t)c->width };
+	while (depth) {
+		size_t room = stack[depth - 1];
+		size_t row = room / c->width;
+		size_t col = room % c->width;
+
+		size_t options[4];
+		size_t count = 0;
+		for (size_t n=0; n < 4; ++n) {
+			if ((n == 0 && col + 2 >= c->width)
+					|| (n == 1 && col < 2)
+					|| (n == 2 && row + 2 >= c->height)
+					|| (n == 3 && row < 2)) {
+				continue;
+			}
+			if (c->cells[room + steps[n]] == '#') {
+				options[count++] = room + steps[n];
+			}
+		}
+
+		if (!count) {
+			depth--;
+			continue;
+		}
+
+		size_t next = options[pick(c, count)];
+		c->cells[(room + next) / 2] = ' ';
+		c->cells[next] = ' ';
+		stack[depth++] = next;
+	}
+
+	free(stack);
+	return true;
+}
+
+// Noise about half wall, smoothed a few times over so that walls gather
+// where most of their neighbors are walls
+static bool grow_caves(struct canvas *c)
+{
+	enum { WALL_PERCENT = 45, SMOOTHING_PASSES = 4, CROWD = 5 };
+
+	size_t size = c->width * c->height;
+	char *next = malloc(size);
+	if (!next) {
+		return false;
+	}
+
+	for (size_t id=0; id < size; ++id) {
+		c->cells[id] = pick(c, 100) < WALL_PERCENT ? '#' : ' ';
+	}
+	seal_border(c);
+
+	for (size_t pass=0; pass < SMOOTHING_PASSES; ++pass) {
+		memcpy(next, c->cells, size);
+		for (size_t row=1; row + 1 < c->height; ++row) {
+			for (size_t col=1; col + 1 < c->width; ++col) {
+				size_t walls = 0;
+				for (size_t r=row - 1; r <= row + 1; ++r) {
+					const char *line = c->cells + r * c->width;
+					walls += (line[col - 1] == '#') + (line[col] == '#')
+						+ (line[col + 1] == '#');
+				}
+				next[row * c->width + col] = walls >= CROWD ? '#' : ' ';
+			}
+		}
+
+		char *swap = c->cells;
+		c->cells = next;
+		next = swap;
+	}
+
+	free(next);
+	return true;
+}
+
+// Digs a wandering tunnel from one cell to the other, always heading
+// closer, so that caves can always be solved
+static void dig_through(struct canvas *c, size_t from, size_t to)
+{
+	size_t row = from / c->width;
+	size_t col = from % c->width;
+	size_t to_row = to / c->width;
+	size_t to_col = to % c->width;
+
+	c->cells[from] = ' ';
+	while (row != to_row || col != to_col) {
+		bool across = row == to_row || (col != to_col && pick(c, 2));
+		if (across) {
+			col += col < to_col ? 1 : -1;
+		} else {
+			row += row < to_row ? 1 : -1;
+		}
+		c->cells[row * c->width + col] = ' ';
+	}
+}
+
+// Lakes are a second, smoothed layer of noise laid over the floor; doors
+// are scattered over whatever floor is left
+static bool flood_terrain(struct canvas *c)
+{
+	enum { CLOSED_PERCENT = 6, OPEN_PERCENT = 4 };
+
+	struct canvas water = *c;
+	water.cells = malloc(c->width * c->height);
+	if (!water.cells) {
+		return false;
+	}
+	if (!grow_caves(&water)) {
+		free(water.cells);
+		return false;
+	}
+	c->random = water.random;
+
+	for (size_t id=0; id < c->width * c->height; ++id) {
+		if (c->cells[id] != ' ') {
+			continue;
+		}
+
+		size_t roll = pick(c, 100);
+		if (water.cells[id] == '#') {
+			c->cells[id] = '~';
+		} else if (roll < CLOSED_PERCENT) {
+			c->cells[id] = '+';
+		} else if (roll < CLOSED_PERCENT + OPEN_PERCENT) {
+			c->cells[id] = '/';
+		}
+	}
+
+	free(water.cells);
+	return true;
+}
+
+// Walls off the cells around id, so that nothing can get in or out
+static void wall_in(struct canvas *c, size_t id)
+{
+	c->cells[id - 1] = '#';
+	c->cells[id + 1] = '#';
+	c->cells[id - c->width] = '#';
+	c->cells[id + c->width] = '#';
+}
+
+static void seal_border(struct canvas *c)
+{
+	memset(c->cells, '#', c->width);
+	memset(c->cells + c->width * (c->height - 1), '#', c->width);
+	for (size_t row=0; row < c->height; ++row) {
+		c->cells[row * c->width] = '#';
+		c->cells[row * c->width + c->width - 1] = '#';
+	}
+}
+
+static bool write_maze(const struct canvas *c, FILE *out)
+{
+	for (size_t row=0; row < c->height; ++row) {
+		if (fwrite(c->cells + row * c->width, 1, c->width, out) != c->width
+				|| putc('\n', out) == EOF) {
+			return false;
+		}
+	}
+
+	return fflush(out) == 0;
+}
@@ -0,0 +1,64 @@
+#!/bin/bash
+
+# Runs maze over generated mazes of every kind, from 1e3 cells up by tens
+# to the largest size given (1e7 by default, 1e8 at most), and prints a
+# line of CSV for each:
+#
+#     kind,cells,seconds,peak_kib,nodes_expanded,status
+#
+# Any further arguments are passed on to maze, so "./bench/scale.bash 1e6 -a"
+# shows how A* scales.  Mazes are generated with a fixed seed into
+# $CORPUS_DIR (bench/corpus by default) and kept for the next run.
+
+BENCH_DIR=$(dirname "$0")
+PROGRAM=$BENCH_DIR/../maze
+GENERATOR=$BENCH_DIR/genmaze
+CORPUS_DIR=${CORPUS_DIR:-$BENCH_DIR/corpus}
+SEED=1
+KINDS="perfect caves terrain unsolvable unbounded"
+
+LARGEST=$(printf "%.0f" "${1:-1e7}" 2> /dev/null)
+if [ -z "$LARGEST" ] || [ "$LARGEST" -lt 1000 ] \
+        || [ "$LARGEST" -gt 100000000 ]; then
+    echo "Usage: $0 [largest cells, 1e3 to 1e8] [maze options...]" >&2
+    exit 1
+fi
+shift
+
+if [ ! -x "$PROGRAM" ] || [ ! -x "$GENERATOR" ]; then
+    echo "Error: run make bench first" >&2
+    exit 1
+fi
+
+mkdir -p "$CORPUS_DIR" || exit 1
+STATS=$(mktemp) || exit 1
+trap 'rm -f "$STATS"' EXIT
+
+echo "kind,cells,seconds,peak_kib,nodes_expanded,status"
+for ((CELLS = 1000; CELLS <= LARGEST; CELLS *= 10)); do
+    for KIND in $KINDS; do
+        MAZE=$CORPUS_DIR/$KIND-$CELLS-$SEED.txt
+        if [ ! -f "$MAZE" ]; then
+            "$GENERATOR" "$KIND" "$CELLS" "$SEED" > "$MAZE.part" \
+                && mv "$MAZE.part" "$MAZE" || exit 1
+        fi
+
+        # Terrain needs both doors and water let in
+        OPTIONS="-s $*"
+        if [ "$KIND" == "terrain" ]; then
+            OPTIONS="$OPTIONS -dw"
+        fi
+
+        BEFORE=$(date +%s%N)
+        $PROGRAM $OPTIONS "$MAZE" > /dev/null 2> "$STATS"
+        STATUS=$?
+        AFTER=$(date +%s%N)
+
+        EXPANDED=$(sed -n 's/^Nodes expanded: //p' "$STATS")
+        PEAK=$(sed -n 's/^Peak memory: \([0-9]*\) KiB$/\1/p' "$STATS")
+        MICROSECONDS=$(((AFTER - BEFORE) / 1000))
+        printf "%s,%d,%d.%06d,%s,%s,%d\n" "$KIND" "$CELLS" \
+            $((MICROSECONDS / 1000000)) $((MICROSECONDS % 1000000)) \
+            "$PEAK" "$EXPANDED" "$STATUS"
+    done
+done
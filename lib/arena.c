@@ -0,0 +1,127 @@
+#include "arena.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+struct chunk {
+	struct chunk *next;
+
+	// Aligned for anything, and every object size is a multiple of its
+	// own alignment, so each object in here is aligned too
+	_Alignas(max_align_t) char objects[];
+};
+
+struct arena_ {
+	// Newest first
+	struct chunk *chunks;
+	// The part of the newest chunk not yet handed out
+	char *next;
+	char *end;
+
+	// Objects given back, linked through their first bytes
+	void *free_list;
+
+	size_t object_size;
+	size_t chunk_objects;
+};
+
+// Chunks start small, so that small graphs stay small, and double up to a
+// size where a malloc per chunk is lost in the noise
+enum { FIRST_CHUNK_OBJECTS = 64, LAST_CHUNK_OBJECTS = 64 * 1024 };
+
+static bool add_chunk(arena *a);
+
+arena *arena_create(size_t object_size)
+{
+	if (!object_size) {
+		return NULL;
+	}
+
+	arena *a = malloc(sizeof(*a));
+	if (!a) {
+		return NULL;
+	}
+
+	// Room for the free list's link, and kept aligned for it
+	if (object_size < sizeof(void *)) {
+		object_size = sizeof(void *);
+	}
+	object_size = (object_size + sizeof(void *) - 1)
+		/ sizeof(void *) * sizeof(void *);
+
+	a->chunks = NULL;
+	a->next = NULL;
+	a->end = NULL;
+	a->free_list = NULL;
+	a->object_size = object_size;
+	a->chunk_objects = FIRST_CHUNK_OBJECTS;
+
+	return a;
+}
+
+void *arena_alloc(arena *a)
+{
+	if (!a) {
+		return NULL;
+	}
+
+	if (a->free_list) {
+		void *obj = a->free_list;
+		a->free_list = *(void **)obj;
+		return obj;
+	}
+
+	if (a->next == a->end && !add_chunk(a)) {
+		return NULL;
+	}
+
+	void *obj = a->next;
+	a->next += a->object_size;
+	return obj;
+}
+
+void arena_free(arena *a, void *obj)
+{
+	if (!a || !obj) {
+		return;
+	}
+
+	*(void **)obj = a->free_list;
+	a->free_list = obj;
+}
+
+void arena_destroy(arena *a)
+{
+	if (!a) {
+		return;
+	}
+
+	struct chunk *curr = a->chunks;
+	while (curr) {
+		struct chunk *tmp = curr->next;
+		free(curr);
+		curr = tmp;
+	}
+
+	free(a);
+}
+
+static bool add_chunk(arena *a)
+{
+	struct chunk *new = malloc(sizeof(*new)
+			+ a->chunk_objects * a->object_size);
+	if (!new) {
+		return false;
+	}
+
+	new->next = a->chunks;
+	a->chunks = new;
+	a->next = new->objects;
+	a->end = new->objects + a->chunk_objects * a->object_size;
+
+	if (a->chunk_objects < LAST_CHUNK_OBJECTS) {
+		a->chunk_objects *= 2;
+	}
+
+	return true;
+}
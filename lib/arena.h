@@ -0,0 +1,24 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Hands out objects of a single size from large chunks, so that getting
+// one is usually just a pointer bump, neighbors in time sit next to each
+// other in memory, and all of them are released one chunk at a time
+typedef struct arena_ arena;
+
+// Returns NULL on an object_size of 0 or if memory runs out
+arena *arena_create(size_t object_size);
+
+// Returns NULL if memory runs out
+void *arena_alloc(arena *a);
+
+// Puts obj, which must have come from a, on a free list for arena_alloc to
+// hand out again; its memory goes back to the system with the arena's
+void arena_free(arena *a, void *obj);
+
+// Releases every object the arena handed out, at once
+void arena_destroy(arena *a);
+
+#endif
@@ -1,9 +1,12 @@
 #include "graph.h"
 
 #include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
+
 struct edge {
 	struct node *out;
 	double weight;
@@ -18,20 +21,105 @@ struct node {
 
 	// Linked List scaffolding for our nodes in the graph
 	struct node *next;
+	struct node *prev;
+
+	// Chain of nodes sharing a bucket in the hash index
+	struct node *chain;
+	size_t hash;
+
+	// Only meaningful while the graph is being frozen
+	size_t id;
 };
 
 struct graph_ {
 	// Head of the linked list of nodes
 	struct node *nodes;
+	size_t size;
 
 	int (*cmp)(const void *a, const void *b);
 	void (*destroy)(void *obj);
+
+	// Hash index over the nodes; without a hash function, lookups fall
+	// back to walking the list
+	size_t (*hash)(const void *obj);
+	struct node **buckets;
+	size_t capacity;
+
+	// Only set for graphs made by graph_create_arena, whose nodes and
+	// edges are carved out of these rather than malloc'd one at a time
+	arena *nodes_arena;
+	arena *edges_arena;
+
+	// Only set for grid graphs, whose nodes and edges are implied by
+	// the cells rather than stored in the list above; cells is the
+	// grid's own array, if it keeps one, for quicker reads
+	const grid *grid;
+	const char *cells;
+	size_t width;
+	size_t height;
+	double (*weight)(char cell);
+
+	// Only set for frozen graphs, which keep their nodes in compressed
+	// sparse row form: the edges out of node id are the entries
+	// offsets[id] up to offsets[id + 1] of targets and weights
+	size_t *offsets;
+	size_t *targets;
+	double *weights;
+	// The same edges transposed, so that in_offsets[id] up to
+	// in_offsets[id + 1] of sources and in_weights lead into node id
+	size_t *in_offsets;
+	size_t *sources;
+	double *in_weights;
+	void **data;
+	// Open-addressed from data to (id + 1), with 0 marking a free slot
+	size_t *ids;
 };
 
 
+// Power of two, so that a bucket is just the low bits of a hash
+// Seems like a reasonable load factor for a hashtable (out of 100)
+enum { STARTING_INDEX_SIZE = 16, LOAD_FACTOR = 75 };
+
+static int ptrcmp(const void *a, const void *b);
+static size_t strhash(const void *data);
+static size_t ptrhash(const void *data);
+
 const graph_cmp_func GRAPH_STRCMP = (graph_cmp_func)strcmp;
+const graph_hash_func GRAPH_STRHASH = strhash;
+const graph_cmp_func GRAPH_PTRCMP = ptrcmp;
+const graph_hash_func GRAPH_PTRHASH = ptrhash;
+
+static bool is_read_only(const graph *g);
+static struct node *find_node(const graph *g, const void *data);
+static bool index_node(graph *g, struct node *n);
+static void unindex_node(graph *g, struct node *n);
+static size_t frozen_find(const graph *g, const void *data);
+static struct node *alloc_node(graph *g);
+static struct edge *alloc_edge(graph *g);
+static void free_node(graph *g, struct node *n);
+static void free_edge(graph *g, struct edge *e);
+static void release_linked(graph *g);
+
+static char cell_at(const graph *g, size_t idx);
+static bool grid_is_open(const graph *g, size_t idx);
+static bool grid_is_adjacent(const graph *g, size_t src, size_t dst);
+static size_t grid_neighbors(const graph *g, size_t idx, size_t nbrs[4]);
 
 graph *graph_create(graph_cmp_func cmp, graph_destroy_func destroy)
+{
+	// The built-in comparisons come with matching hashes
+	graph_hash_func hash = NULL;
+	if (cmp == GRAPH_STRCMP) {
+		hash = GRAPH_STRHASH;
+	} else if (cmp == GRAPH_PTRCMP) {
+		hash = GRAPH_PTRHASH;
+	}
+
+	return graph_create_hashed(cmp, hash, destroy);
+}
+
+graph *graph_create_hashed(graph_cmp_func cmp, graph_hash_func hash,
+		graph_destroy_func destroy)
 {
 	if (!cmp) {
 		return NULL;
@@ -42,8 +130,64 @@ graph *graph_create(graph_cmp_func cmp, graph_destroy_func destroy)
 	}
 
 	g->nodes = NULL;
+	g->size = 0;
 	g->cmp = cmp;
 	g->destroy = destroy;
+	g->hash = hash;
+	g->buckets = NULL;
+	g->capacity = 0;
+	g->nodes_arena = NULL;
+	g->edges_arena = NULL;
+	g->grid = NULL;
+	g->cells = NULL;
+	g->width = 0;
+	g->height = 0;
+	g->weight = NULL;
+	g->offsets = NULL;
+	g->targets = NULL;
+	g->weights = NULL;
+	g->in_offsets = NULL;
+	g->sources = NULL;
+	g->in_weights = NULL;
+	g->data = NULL;
+	g->ids = NULL;
+
+	return g;
+}
+
+graph *graph_create_arena(graph_cmp_func cmp, graph_destroy_func destroy)
+{
+	graph *g = graph_create(cmp, destroy);
+	if (!g) {
+		return NULL;
+	}
+
+	g->nodes_arena = arena_create(sizeof(struct node));
+	g->edges_arena = arena_create(sizeof(struct edge));
+	if (!g->nodes_arena || !g->edges_arena) {
+		graph_destroy(g);
+		return NULL;
+	}
+
+	return g;
+}
+
+graph *graph_create_grid(const grid *cells, graph_weight_func weight)
+{
+	if (!cells || !weight) {
+		return NULL;
+	}
+
+	graph *g = graph_create_hashed(GRAPH_PTRCMP, NULL, NULL);
+	if (!g) {
+		return NULL;
+	}
+
+	g->grid = cells;
+	g->cells = grid_chars(cells);
+	g->width = grid_width(cells);
+	g->height = grid_height(cells);
+	g->weight = weight;
 
 	return g;
 }
@@ -54,19 +198,23 @@ size_t graph_size(const graph *g)
 		return 0;
 	}
 
-	size_t count = 0;
-	struct node *curr = g->nodes;
-	while (curr) {
-		++count;
-		curr = curr->next;
+	if (g->grid) {
+		size_t count = 0;
+		for (size_t n=0; n < g->width * g->height; ++n) {
+			if (grid_is_open(g, n)) {
+				++count;
+			}
+		}
+
+		return count;
 	}
 
-	return count;
+	return g->size;
 }
 
 bool graph_add_node(graph *g, void *data)
 {
-	if (!g || !data) {
+	if (!g || !data || is_read_only(g)) {
 		return false;
 	}
 
@@ -75,76 +223,88 @@ bool graph_add_node(graph *g, void *data)
 		return true;
 	}
 
-	struct node *new = malloc(sizeof(*new));
+	struct node *new = alloc_node(g);
 	if (!new) {
 		return false;
 	}
 
 	new->data = data;
 	new->edges = NULL;
+	if (!index_node(g, new)) {
+		free_node(g, new);
+		return false;
+	}
+
+	new->prev = NULL;
 	new->next = g->nodes;
+	if (g->nodes) {
+		g->nodes->prev = new;
+	}
 	g->nodes = new;
+	g->size++;
 
 	return true;
 }
 
 void graph_remove_edge(graph *g, const void *src, const void *dst)
 {
-	if (!g || !src || !dst) {
+	if (!g || !src || !dst || is_read_only(g)) {
 		return;
 	}
 
-	struct node *from = g->nodes;
-	while (from) {
-		if (g->cmp(from->data, src) == 0) {
-			struct edge **curr = &from->edges;
-			while (*curr) {
-				if (g->cmp((*curr)->out->data, dst) == 0) {
-					struct edge *to_free = *curr;
-					*curr = (*curr)->next;
-					free(to_free);
-
-					return;
-				}
-
-				curr = &(*curr)->next;
-			}
-
+	struct node *from = find_node(g, src);
+	if (!from) {
+		return;
+	}
 
+	struct edge **curr = &from->edges;
+	while (*curr) {
+		if (g->cmp((*curr)->out->data, dst) == 0) {
+			struct edge *to_free = *curr;
+			*curr = (*curr)->next;
+			free_edge(g, to_free);
 
+			return;
 		}
-		from = from->next;
+
+		curr = &(*curr)->next;
 	}
 }
 
 void graph_remove_node(graph *g, void *data)
 {
-	if (!g || !data) {
+	if (!g || !data || is_read_only(g)) {
 		return;
 	}
 
-	struct node **curr = &g->nodes;
-	while (*curr) {
-		if (g->cmp(data, (*curr)->data) == 0) {
-			struct node *to_free = *curr;
-			*curr = (*curr)->next;
+	struct node *to_free = find_node(g, data);
+	if (!to_free) {
+		return;
+	}
 
-			if (g->destroy) {
-				g->destroy(to_free->data);
-			}
-			struct edge *e = to_free->edges;
-			while (e) {
-				struct edge *next = e->next;
-				free(e);
+	unindex_node(g, to_free);
+	if (to_free->prev) {
+		to_free->prev->next = to_free->next;
+	} else {
+		g->nodes = to_free->next;
+	}
+	if (to_free->next) {
+		to_free->next->prev = to_free->prev;
+	}
+	g->size--;
 
-				e = next;
-			}
+	if (g->destroy) {
+		g->destroy(to_free->data);
+	}
+	struct edge *e = to_free->edges;
+	while (e) {
+		struct edge *next = e->next;
+		free_edge(g, e);
 
-			free(to_free);
-			return;
-		}
-		curr = &(*curr)->next;
+		e = next;
 	}
+
+	free_node(g, to_free);
 }
 
 bool graph_contains(const graph *g, const void *data)
@@ -153,37 +313,23 @@ bool graph_contains(const graph *g, const void *data)
 		return false;
 	}
 
-	struct node *curr = g->nodes;
-	while (curr) {
-		if (g->cmp(data, curr->data) == 0) {
-			return true;
-		}
-
-		curr = curr->next;
+	if (g->grid) {
+		return grid_is_open(g, (size_t)data);
+	} else if (g->offsets) {
+		return frozen_find(g, data) != GRAPH_NO_ID;
 	}
 
-	return false;
+	return find_node(g, data) != NULL;
 }
 
 bool graph_add_edge(graph *g, void *src, void *dst, double weight)
 {
-	if (!g || !src || !dst) {
+	if (!g || !src || !dst || is_read_only(g)) {
 		return false;
 	}
 
-	struct node *from = NULL;
-	struct node *to = NULL;
-
-	struct node *curr = g->nodes;
-	while (curr && (!from || !to)) {
-		if (g->cmp(curr->data, src) == 0) {
-			from = curr;
-		}
-		if (g->cmp(curr->data, dst) == 0) {
-			to = curr;
-		}
-		curr = curr->next;
-	}
+	struct node *from = find_node(g, src);
+	struct node *to = find_node(g, dst);
 	if (!from || !to) {
 		return false;
 	}
@@ -198,7 +344,7 @@ bool graph_add_edge(graph *g, void *src, void *dst, double weight)
 		checker = checker->next;
 	}
 
-	struct edge *new = malloc(sizeof(*new));
+	struct edge *new = alloc_edge(g);
 	if (!new) {
 		return false;
 	}
@@ -217,14 +363,31 @@ double graph_get_edge_weight(const graph *g, const void *src, const void *dst)
 		return NAN;
 	}
 
-	// This is the node that the edge starts from
-	struct node *from = g->nodes;
-	while (from) {
-		if (g->cmp(from->data, src) == 0) {
-			break;
+	if (g->grid) {
+		if (!grid_is_open(g, (size_t)src) || !grid_is_open(g, (size_t)dst)
+				|| !grid_is_adjacent(g, (size_t)src, (size_t)dst)) {
+			return NAN;
 		}
-		from = from->next;
+
+		return g->weight(cell_at(g, (size_t)dst));
+	} else if (g->offsets) {
+		size_t from = frozen_find(g, src);
+		size_t to = frozen_find(g, dst);
+		if (from == GRAPH_NO_ID || to == GRAPH_NO_ID) {
+			return NAN;
+		}
+
+		for (size_t n=g->offsets[from]; n < g->offsets[from + 1]; ++n) {
+			if (g->targets[n] == to) {
+				return g->weights[n];
+			}
+		}
+
+		return NAN;
 	}
+
+	// This is the node that the edge starts from
+	struct node *from = find_node(g, src);
 	if (!from) {
 		return false;
 	}
@@ -246,14 +409,18 @@ size_t graph_outdegree_size(const graph *g, const void *from)
 		return 0;
 	}
 
-	// This is the node that the edges start from
-	struct node *n = g->nodes;
-	while (n) {
-		if (g->cmp(n->data, from) == 0) {
-			break;
-		}
-		n = n->next;
+	if (g->grid) {
+		size_t nbrs[4];
+		return grid_is_open(g, (size_t)from) ?
+			grid_neighbors(g, (size_t)from, nbrs) : 0;
+	} else if (g->offsets) {
+		size_t id = frozen_find(g, from);
+		return id == GRAPH_NO_ID ? 0
+			: g->offsets[id + 1] - g->offsets[id];
 	}
+
+	// This is the node that the edges start from
+	struct node *n = find_node(g, from);
 	if (!n) {
 		return 0;
 	}
@@ -274,13 +441,16 @@ size_t graph_indegree_size(const graph *g, const void *to)
 		return 0;
 	}
 
-	struct node *dest = g->nodes;
-	while (dest) {
-		if (g->cmp(dest->data, to) == 0) {
-			break;
-		}
-		dest = dest->next;
+	// Grid edges always come in pairs, so in and out degrees match
+	if (g->grid) {
+		return graph_outdegree_size(g, to);
+	} else if (g->offsets) {
+		size_t id = frozen_find(g, to);
+		return id == GRAPH_NO_ID ? 0
+			: g->in_offsets[id + 1] - g->in_offsets[id];
 	}
+
+	struct node *dest = find_node(g, to);
 	if (!dest) {
 		return 0;
 	}
@@ -309,6 +479,20 @@ void graph_iterate_nodes(const graph *g, void (*func)(const void *))
 		return;
 	}
 
+	if (g->grid) {
+		for (size_t n=0; n < g->width * g->height; ++n) {
+			if (grid_is_open(g, n)) {
+				func((const void *)n);
+			}
+		}
+		return;
+	} else if (g->offsets) {
+		for (size_t id=0; id < g->size; ++id) {
+			func(g->data[id]);
+		}
+		return;
+	}
+
 	struct node *curr = g->nodes;
 	while (curr) {
 		func(curr->data);
@@ -323,14 +507,30 @@ void graph_iterate_neighbors(const graph *g, const void *obj,
 		return;
 	}
 
-	struct node *curr = g->nodes;
-	while (curr) {
-		if (g->cmp(curr->data, obj) == 0) {
-			break;
+	if (g->grid) {
+		if (!grid_is_open(g, (size_t)obj)) {
+			return;
 		}
 
-		curr = curr->next;
+		size_t nbrs[4];
+		size_t count = grid_neighbors(g, (size_t)obj, nbrs);
+		for (size_t n=0; n < count; ++n) {
+			func((const void *)nbrs[n]);
+		}
+		return;
+	} else if (g->offsets) {
+		size_t id = frozen_find(g, obj);
+		if (id == GRAPH_NO_ID) {
+			return;
+		}
+
+		for (size_t n=g->offsets[id]; n < g->offsets[id + 1]; ++n) {
+			func(g->data[g->targets[n]]);
+		}
+		return;
 	}
+
+	struct node *curr = find_node(g, obj);
 	if (!curr) {
 		return;
 	}
@@ -343,12 +543,67 @@ void graph_iterate_neighbors(const graph *g, const void *obj,
 	}
 }
 
+void graph_iterate_neighbors_r(const graph *g, const void *obj,
+		void (*func)(const void *, double, void *), void *arg)
+{
+	if (!g || !obj || !func) {
+		return;
+	}
+
+	if (g->grid) {
+		if (!grid_is_open(g, (size_t)obj)) {
+			return;
+		}
+
+		size_t nbrs[4];
+		size_t count = grid_neighbors(g, (size_t)obj, nbrs);
+		for (size_t n=0; n < count; ++n) {
+			func((const void *)nbrs[n], g->weight(cell_at(g, nbrs[n])), arg);
+		}
+		return;
+	} else if (g->offsets) {
+		size_t id = frozen_find(g, obj);
+		if (id == GRAPH_NO_ID) {
+			return;
+		}
+
+		for (size_t n=g->offsets[id]; n < g->offsets[id + 1]; ++n) {
+			func(g->data[g->targets[n]], g->weights[n], arg);
+		}
+		return;
+	}
+
+	struct node *curr = find_node(g, obj);
+	if (!curr) {
+		return;
+	}
+
+	struct edge *e = curr->edges;
+	while (e) {
+		func(e->out->data, e->weight, arg);
+
+		e = e->next;
+	}
+}
+
 void graph_serialize(const graph *g, FILE *output)
 {
 	if (!g || !output || g->cmp != GRAPH_STRCMP) {
 		return;
 	}
 
+	if (g->offsets) {
+		for (size_t id=0; id < g->size; ++id) {
+			printf("%s", (const char *)g->data[id]);
+			for (size_t n=g->offsets[id]; n < g->offsets[id + 1]; ++n) {
+				printf(" %s %f", (const char *)g->data[g->targets[n]],
+						g->weights[n]);
+			}
+			putchar('\n');
+		}
+		return;
+	}
+
 	struct node *n = g->nodes;
 	while (n) {
 		printf("%s", (const char *)n->data);
@@ -441,12 +696,310 @@ graph *graph_deserialize(FILE *input)
 	return g;
 }
 
+graph *graph_freeze(graph *g)
+{
+	if (!g || is_read_only(g)) {
+		return g;
+	}
+
+	size_t edge_count = 0;
+	size_t id = 0;
+	for (struct node *n = g->nodes; n; n = n->next) {
+		n->id = id++;
+		for (struct edge *e = n->edges; e; e = e->next) {
+			++edge_count;
+		}
+	}
+
+	// Twice as many slots as nodes keeps the probes short
+	size_t capacity = STARTING_INDEX_SIZE;
+	while (capacity < 2 * g->size) {
+		capacity *= 2;
+	}
+
+	size_t *offsets = malloc((g->size + 1) * sizeof(*offsets));
+	size_t *targets = malloc(edge_count * sizeof(*targets) + 1);
+	double *weights = malloc(edge_count * sizeof(*weights) + 1);
+	void **data = malloc(g->size * sizeof(*data) + 1);
+	size_t *in_offsets = calloc(g->size + 1, sizeof(*in_offsets));
+	size_t *sources = malloc(edge_count * sizeof(*sources) + 1);
+	double *in_weights = malloc(edge_count * sizeof(*in_weights) + 1);
+	size_t *ids = g->hash ? calloc(capacity, sizeof(*ids)) : NULL;
+	if (!offsets || !targets || !weights || !data || !in_offsets
+			|| !sources || !in_weights || (g->hash && !ids)) {
+		free(offsets);
+		free(targets);
+		free(weights);
+		free(data);
+		free(in_offsets);
+		free(sources);
+		free(in_weights);
+		free(ids);
+		return NULL;
+	}
+
+	// Ids follow the node list, and targets follow each edge list, so
+	// iteration order is the same before and after freezing
+	size_t count = 0;
+	for (struct node *n = g->nodes; n; n = n->next) {
+		offsets[n->id] = count;
+		data[n->id] = n->data;
+		for (struct edge *e = n->edges; e; e = e->next) {
+			targets[count] = e->out->id;
+			weights[count] = e->weight;
+			++in_offsets[e->out->id + 1];
+			++count;
+		}
+
+		if (ids) {
+			size_t slot = n->hash & (capacity - 1);
+			while (ids[slot]) {
+				slot = (slot + 1) & (capacity - 1);
+			}
+			ids[slot] = n->id + 1;
+		}
+	}
+	offsets[g->size] = count;
+
+	// Counting sort the edges by target; walking the sources in id order
+	// leaves each node's in-edges sorted by where they come from
+	for (size_t id=0; id < g->size; ++id) {
+		in_offsets[id + 1] += in_offsets[id];
+	}
+	for (size_t id=0; id < g->size; ++id) {
+		for (size_t n=offsets[id]; n < offsets[id + 1]; ++n) {
+			size_t slot = in_offsets[targets[n]]++;
+			sources[slot] = id;
+			in_weights[slot] = weights[n];
+		}
+	}
+	for (size_t id=g->size; id > 0; --id) {
+		in_offsets[id] = in_offsets[id - 1];
+	}
+	in_offsets[0] = 0;
+
+	// Release the linked form; the data now belongs to the frozen arrays
+	release_linked(g);
+	free(g->buckets);
+
+	g->nodes = NULL;
+	g->buckets = NULL;
+	g->capacity = ids ? capacity : 0;
+	g->offsets = offsets;
+	g->targets = targets;
+	g->weights = weights;
+	g->in_offsets = in_offsets;
+	g->sources = sources;
+	g->in_weights = in_weights;
+	g->data = data;
+	g->ids = ids;
+
+	return g;
+}
+
+size_t graph_id_bound(const graph *g)
+{
+	if (!g) {
+		return 0;
+	} else if (g->grid) {
+		return g->width * g->height;
+	} else if (g->offsets) {
+		return g->size;
+	}
+
+	return 0;
+}
+
+size_t graph_node_id(const graph *g, const void *data)
+{
+	if (!g || !data) {
+		return GRAPH_NO_ID;
+	} else if (g->grid) {
+		return grid_is_open(g, (size_t)data) ? (size_t)data : GRAPH_NO_ID;
+	} else if (g->offsets) {
+		return frozen_find(g, data);
+	}
+
+	return GRAPH_NO_ID;
+}
+
+void *graph_node_data(const graph *g, size_t id)
+{
+	if (!g) {
+		return NULL;
+	} else if (g->grid) {
+		return grid_is_open(g, id) ? (void *)id : NULL;
+	} else if (g->offsets && id < g->size) {
+		return g->data[id];
+	}
+
+	return NULL;
+}
+
+void graph_iterate_neighbor_ids(const graph *g, size_t id,
+		graph_id_visit_func func, void *arg)
+{
+	if (!g || !func) {
+		return;
+	}
+
+	if (g->grid) {
+		if (!grid_is_open(g, id)) {
+			return;
+		}
+
+		size_t nbrs[4];
+		size_t count = grid_neighbors(g, id, nbrs);
+		for (size_t n=0; n < count; ++n) {
+			func(nbrs[n], g->weight(cell_at(g, nbrs[n])), arg);
+		}
+	} else if (g->offsets && id < g->size) {
+		for (size_t n=g->offsets[id]; n < g->offsets[id + 1]; ++n) {
+			func(g->targets[n], g->weights[n], arg);
+		}
+	}
+}
+
+void graph_iterate_in_neighbor_ids(const graph *g, size_t id,
+		graph_id_visit_func func, void *arg)
+{
+	if (!g || !func) {
+		return;
+	}
+
+	if (g->grid) {
+		if (!grid_is_open(g, id)) {
+			return;
+		}
+
+		// Every edge into a cell costs that cell's weight, and grid
+		// edges come in pairs, so the sources are just the neighbors
+		size_t nbrs[4];
+		size_t count = grid_neighbors(g, id, nbrs);
+		double weight = g->weight(cell_at(g, id));
+		for (size_t n=0; n < count; ++n) {
+			func(nbrs[n], weight, arg);
+		}
+	} else if (g->offsets && id < g->size) {
+		for (size_t n=g->in_offsets[id]; n < g->in_offsets[id + 1]; ++n) {
+			func(g->sources[n], g->in_weights[n], arg);
+		}
+	}
+}
+
+size_t graph_grid_width(const graph *g)
+{
+	return g && g->grid ? g->width : 0;
+}
+
+double graph_grid_cost(const graph *g, size_t id)
+{
+	// Index 0 would be a NULL node, so it is never part of the graph
+	if (!g || !g->grid || id == 0 || id >= g->width * g->height) {
+		return 0;
+	}
+
+	return g->weight(cell_at(g, id));
+}
+
+size_t graph_neighbor_ids(const graph *g, size_t id, const size_t **targets,
+		const double **weights)
+{
+	if (!g || !g->offsets || id >= g->size) {
+		return 0;
+	}
+
+	if (targets) {
+		*targets = g->targets + g->offsets[id];
+	}
+	if (weights) {
+		*weights = g->weights + g->offsets[id];
+	}
+
+	return g->offsets[id + 1] - g->offsets[id];
+}
+
 void graph_destroy(graph *g)
 {
 	if (!g) {
 		return;
 	}
 
+	if (g->offsets) {
+		for (size_t id=0; id < g->size && g->destroy; ++id) {
+			g->destroy(g->data[id]);
+		}
+		free(g->offsets);
+		free(g->targets);
+		free(g->weights);
+		free(g->in_offsets);
+		free(g->sources);
+		free(g->in_weights);
+		free(g->data);
+		free(g->ids);
+	}
+
+	for (struct node *n = g->nodes; n && g->destroy; n = n->next) {
+		g->destroy(n->data);
+	}
+	release_linked(g);
+
+	free(g->buckets);
+	free(g);
+}
+
+static bool is_read_only(const graph *g)
+{
+	return g->grid || g->offsets;
+}
+
+static struct node *alloc_node(graph *g)
+{
+	if (g->nodes_arena) {
+		return arena_alloc(g->nodes_arena);
+	}
+	return malloc(sizeof(struct node));
+}
+
+static struct edge *alloc_edge(graph *g)
+{
+	if (g->edges_arena) {
+		return arena_alloc(g->edges_arena);
+	}
+	return malloc(sizeof(struct edge));
+}
+
+static void free_node(graph *g, struct node *n)
+{
+	if (g->nodes_arena) {
+		arena_free(g->nodes_arena, n);
+	} else {
+		free(n);
+	}
+}
+
+static void free_edge(graph *g, struct edge *e)
+{
+	if (g->edges_arena) {
+		arena_free(g->edges_arena, e);
+	} else {
+		free(e);
+	}
+}
+
+// Frees every node and edge, leaving their data alone; an arena does it a
+// chunk at a time, without walking them
+static void release_linked(graph *g)
+{
+	if (g->nodes_arena) {
+		arena_destroy(g->nodes_arena);
+		arena_destroy(g->edges_arena);
+		g->nodes_arena = NULL;
+		g->edges_arena = NULL;
+		g->nodes = NULL;
+		return;
+	}
+
 	struct node *curr = g->nodes;
 	while (curr) {
 		struct edge *e = curr->edges;
@@ -457,14 +1010,189 @@ void graph_destroy(graph *g)
 		}
 
 		struct node *tmp = curr->next;
-		if (g->destroy) {
-			g->destroy(curr->data);
+		free(curr);
+		curr = tmp;
+	}
+	g->nodes = NULL;
+}
+
+static size_t frozen_find(const graph *g, const void *data)
+{
+	if (!g->ids) {
+		for (size_t id=0; id < g->size; ++id) {
+			if (g->cmp(data, g->data[id]) == 0) {
+				return id;
+			}
 		}
 
-		free(curr);
+		return GRAPH_NO_ID;
+	}
 
-		curr = tmp;
+	size_t slot = g->hash(data) & (g->capacity - 1);
+	while (g->ids[slot]) {
+		size_t id = g->ids[slot] - 1;
+		if (g->cmp(data, g->data[id]) == 0) {
+			return id;
+		}
+		slot = (slot + 1) & (g->capacity - 1);
 	}
 
-	free(g);
+	return GRAPH_NO_ID;
+}
+
+static struct node *find_node(const graph *g, const void *data)
+{
+	if (g->buckets) {
+		size_t hash = g->hash(data);
+		struct node *curr = g->buckets[hash & (g->capacity - 1)];
+		while (curr) {
+			if (curr->hash == hash && g->cmp(data, curr->data) == 0) {
+				return curr;
+			}
+			curr = curr->chain;
+		}
+
+		return NULL;
+	}
+
+	struct node *curr = g->nodes;
+	while (curr) {
+		if (g->cmp(data, curr->data) == 0) {
+			return curr;
+		}
+
+		curr = curr->next;
+	}
+
+	return NULL;
+}
+
+static bool index_node(graph *g, struct node *n)
+{
+	if (!g->hash) {
+		return true;
+	}
+
+	if (!g->buckets || 100 * (g->size + 1) / g->capacity > LOAD_FACTOR) {
+		size_t capacity = g->buckets ? 2 * g->capacity
+			: STARTING_INDEX_SIZE;
+		struct node **copy = calloc(capacity, sizeof(*copy));
+		if (!copy) {
+			return false;
+		}
+
+		// Every indexed node is also on the node list
+		struct node *curr = g->nodes;
+		while (curr) {
+			size_t idx = curr->hash & (capacity - 1);
+			curr->chain = copy[idx];
+			copy[idx] = curr;
+			curr = curr->next;
+		}
+
+		free(g->buckets);
+		g->buckets = copy;
+		g->capacity = capacity;
+	}
+
+	n->hash = g->hash(n->data);
+	size_t idx = n->hash & (g->capacity - 1);
+	n->chain = g->buckets[idx];
+	g->buckets[idx] = n;
+
+	return true;
+}
+
+static void unindex_node(graph *g, struct node *n)
+{
+	if (!g->buckets) {
+		return;
+	}
+
+	struct node **curr = &g->buckets[n->hash & (g->capacity - 1)];
+	while (*curr) {
+		if (*curr == n) {
+			*curr = n->chain;
+			return;
+		}
+		curr = &(*curr)->chain;
+	}
+}
+
+static int ptrcmp(const void *a, const void *b)
+{
+	return (a > b) - (a < b);
+}
+
+// FNV-1a
+static size_t strhash(const void *data)
+{
+	uint64_t hash = 14695981039346656037u;
+	for (const unsigned char *c = data; *c; ++c) {
+		hash ^= *c;
+		hash *= 1099511628211u;
+	}
+
+	return hash;
+}
+
+static size_t ptrhash(const void *data)
+{
+	// Low bits of an address are mostly alignment, so mix the high
+	// bits down before the bucket mask throws them away
+	uint64_t hash = (uintptr_t)data;
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdu;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+static char cell_at(const graph *g, size_t idx)
+{
+	return g->cells ? g->cells[idx] : grid_cell(g->grid, idx);
+}
+
+static bool grid_is_open(const graph *g, size_t idx)
+{
+	// Index 0 would be a NULL node, so it is never part of the graph
+	return idx != 0 && idx < g->width * g->height
+		&& g->weight(cell_at(g, idx)) > 0;
+}
+
+static bool grid_is_adjacent(const graph *g, size_t src, size_t dst)
+{
+	size_t nbrs[4];
+	size_t count = grid_neighbors(g, src, nbrs);
+	for (size_t n=0; n < count; ++n) {
+		if (nbrs[n] == dst) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Fills nbrs with the open cells around idx and returns how many there are.
+// Order is down, right, up, left; that is the order an explicitly built
+// maze graph would hand them back in, so ties break the same way.
+static size_t grid_neighbors(const graph *g, size_t idx, size_t nbrs[4])
+{
+	size_t count = 0;
+
+	if (idx + g->width < g->width * g->height
+			&& grid_is_open(g, idx + g->width)) {
+		nbrs[count++] = idx + g->width;
+	}
+	if ((idx + 1) % g->width != 0 && grid_is_open(g, idx + 1)) {
+		nbrs[count++] = idx + 1;
+	}
+	if (idx >= g->width && grid_is_open(g, idx - g->width)) {
+		nbrs[count++] = idx - g->width;
+	}
+	if (idx % g->width != 0 && grid_is_open(g, idx - 1)) {
+		nbrs[count++] = idx - 1;
+	}
+
+	return count;
 }
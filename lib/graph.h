@@ -2,21 +2,55 @@
 #define GRAPH_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "grid.h"
+
 typedef struct graph_ graph;
 
 typedef int (*graph_cmp_func)(const void *, const void *);
 // Use this as cmp function for a graph to store strings in its nodes
 extern const graph_cmp_func GRAPH_STRCMP;
+// Use this as cmp function to tell nodes apart by their address alone
+extern const graph_cmp_func GRAPH_PTRCMP;
+
+// Must give equal hashes for any data that cmp calls equal
+typedef size_t (*graph_hash_func)(const void *);
+// Hashes to go along with GRAPH_STRCMP and GRAPH_PTRCMP
+extern const graph_hash_func GRAPH_STRHASH;
+extern const graph_hash_func GRAPH_PTRHASH;
 
 typedef void (*graph_destroy_func)(void *);
 
+// Returns the cost of stepping into a cell; 0 marks a wall
+typedef double (*graph_weight_func)(char cell);
+
 // Calls destroy() on each item as they are removed
 // (Pass destroy=NULL to not do anything)
+// Node lookups are hashed for GRAPH_STRCMP and GRAPH_PTRCMP graphs;
+// any other cmp falls back to a linear scan
 graph *graph_create(graph_cmp_func cmp, graph_destroy_func destroy);
 
+// As graph_create, but indexes nodes with hash for O(1) expected lookups
+// (Pass hash=NULL for a linear scan)
+graph *graph_create_hashed(graph_cmp_func cmp, graph_hash_func hash,
+		graph_destroy_func destroy);
+
+// As graph_create, but nodes and edges are carved out of large chunks
+// instead of being malloc'd one at a time, which makes building the graph
+// quicker and keeps it tighter in memory; graph_destroy and graph_freeze
+// then release them a chunk at a time rather than one by one
+graph *graph_create_arena(graph_cmp_func cmp, graph_destroy_func destroy);
+
+// Creates a read-only graph over a grid of cells (which must outlive the
+// graph).  Nodes are the cell indices cast to void *, so index 0 is never
+// a node.  Each open cell is joined to its orthogonal neighbors, and the
+// edge into a cell costs weight(cell).  Nothing is allocated per node or
+// edge.
+graph *graph_create_grid(const grid *cells, graph_weight_func weight);
+
 // Returns number of nodes in graph
 size_t graph_size(const graph *g);
 
@@ -30,6 +64,11 @@ void graph_iterate_nodes(const graph *g, void (*func)(const void *));
 void graph_iterate_neighbors(const graph *g, const void *obj,
 		void (*func)(const void *));
 
+// As graph_iterate_neighbors, but also hands func the weight of the edge
+// to each neighbor and an arg that is passed through untouched
+void graph_iterate_neighbors_r(const graph *g, const void *obj,
+		void (*func)(const void *, double, void *), void *arg);
+
 //TODO Return a pointer to the actual data (essentially graph_get, but then, why?)
 bool graph_contains(const graph *g, const void *data);
 
@@ -50,6 +89,50 @@ void graph_serialize(const graph *g, FILE *output);
 // Creates a graph that "owns" its strings/data
 graph *graph_deserialize(FILE *input);
 
+// Converts g in place to a read-only, compressed sparse row form: nodes get
+// the dense ids 0 .. graph_size(g) - 1 and every node's edges sit next to
+// each other in flat arrays.  The rest of this API keeps working on it, but
+// nodes and edges can no longer be added or removed.  Returns g, which
+// keeps its data and destroy function, or NULL (leaving g as it was) if
+// memory runs out.  Grid and frozen graphs are returned unchanged.
+graph *graph_freeze(graph *g);
+
+// Frozen and grid graphs also number their nodes with dense ids below
+// graph_id_bound(): 0 .. graph_size() - 1 when frozen, the cell indices
+// for a grid.  Any other graph has no ids, and a bound of 0.
+size_t graph_id_bound(const graph *g);
+
+// Returned for data that has no id in g
+#define GRAPH_NO_ID SIZE_MAX
+
+size_t graph_node_id(const graph *g, const void *data);
+void *graph_node_data(const graph *g, size_t id);
+
+typedef void (*graph_id_visit_func)(size_t id, double weight, void *arg);
+
+// Calls func on the id and edge weight of each neighbor of id, passing arg
+// through untouched
+void graph_iterate_neighbor_ids(const graph *g, size_t id,
+		graph_id_visit_func func, void *arg);
+
+// The same, but over the edges coming into id; the weight passed is that
+// of the edge from the neighbor to id
+void graph_iterate_in_neighbor_ids(const graph *g, size_t id,
+		graph_id_visit_func func, void *arg);
+
+// Grid graphs only: the width of the grid, so that the ids left and right
+// of id are id - 1 and id + 1, and those above and below it are id - width
+// and id + width.  0 for any other graph.
+size_t graph_grid_width(const graph *g);
+
+// Grid graphs only: the cost of stepping into id, or 0 if id is not open
+double graph_grid_cost(const graph *g, size_t id);
+
+// Frozen graphs only: points targets and weights at the edges out of id,
+// and returns how many there are
+size_t graph_neighbor_ids(const graph *g, size_t id, const size_t **targets,
+		const double **weights);
+
 void graph_destroy(graph *g);
 
 #endif
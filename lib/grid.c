@@ -0,0 +1,365 @@
+#include "grid.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct grid_ {
+	size_t width;
+	size_t height;
+
+	// Set for grids held in memory, ring and all
+	char *cells;
+
+	// Mapped and packed grids keep the lines of the file without the
+	// ring: line n is lengths[n] cells from offsets[n] on
+	size_t *offsets;
+	size_t *lengths;
+	size_t lines;
+	size_t line_capacity;
+
+	// Set for mapped grids, whose cells are the file's bytes
+	const char *base;
+	size_t size;
+
+	// Set for packed grids, whose cells are 4-bit indices into symbols,
+	// two to a byte with the lower index in the low bits
+	unsigned char *codes;
+	size_t used;
+	size_t capacity;
+	char symbols[GRID_PACKED_SYMBOLS + 1];
+	// The code for each char, or NO_CODE for those not among symbols
+	unsigned char code_of[UCHAR_MAX + 1];
+};
+
+// Mapped and packed grids start with room for this many lines, and packed
+// grids with this many bytes of cells; indexing a mapped file lets go of
+// each RELEASE_BYTES of it read
+enum {
+	STARTING_LINES = 64, STARTING_CODES = 4096, NO_CODE = 0xff,
+	RELEASE_BYTES = 1 << 20
+};
+
+static grid *grid_blank(size_t width, size_t height);
+static bool add_line(grid *gr, size_t offset, size_t length);
+static char line_cell(const grid *gr, size_t at);
+static void release(const grid *gr, size_t from, size_t to);
+
+grid *grid_create(char *cells, size_t width, size_t height)
+{
+	if (!cells || width < 2 || height < 2) {
+		return NULL;
+	}
+
+	grid *gr = grid_blank(width, height);
+	if (!gr) {
+		return NULL;
+	}
+	gr->cells = cells;
+
+	return gr;
+}
+
+grid *grid_map(int fd)
+{
+	struct stat info;
+	if (fstat(fd, &info) < 0) {
+		return NULL;
+	} else if (!S_ISREG(info.st_mode)) {
+		// As mmap itself would say
+		errno = ENODEV;
+		return NULL;
+	}
+
+	grid *gr = grid_blank(2, 2);
+	if (!gr) {
+		return NULL;
+	}
+
+	// Nothing to map in an empty file; it is just the ring
+	if (info.st_size == 0) {
+		return gr;
+	}
+
+	void *base = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (base == MAP_FAILED) {
+		free(gr);
+		return NULL;
+	}
+	gr->base = base;
+	gr->size = info.st_size;
+
+	// Indexing reads the file straight through once; after that the
+	// search only touches the pages along its way
+	madvise(base, gr->size, MADV_SEQUENTIAL);
+
+	size_t released = 0;
+	for (size_t at = 0; at < gr->size;) {
+		const char *end = memchr(gr->base + at, '\n', gr->size - at);
+		size_t length = end ? (size_t)(end - gr->base) - at : gr->size - at;
+		if (!add_line(gr, at, length)) {
+			grid_destroy(gr);
+			return NULL;
+		}
+
+		at += length + 1;
+		if (at - released >= RELEASE_BYTES) {
+			release(gr, released, at);
+			released = at;
+		}
+	}
+	release(gr, released, gr->size);
+
+	madvise(base, gr->size, MADV_RANDOM);
+
+	return gr;
+}
+
+grid *grid_create_packed(const char *symbols)
+{
+	if (!symbols || strlen(symbols) > GRID_PACKED_SYMBOLS) {
+		return NULL;
+	}
+
+	grid *gr = grid_blank(2, 2);
+	if (!gr) {
+		return NULL;
+	}
+
+	gr->codes = malloc(STARTING_CODES);
+	if (!gr->codes) {
+		free(gr);
+		return NULL;
+	}
+	gr->capacity = STARTING_CODES;
+	strcpy(gr->symbols, symbols);
+	memset(gr->code_of, NO_CODE, sizeof(gr->code_of));
+	for (size_t n = 0; symbols[n]; ++n) {
+		gr->code_of[(unsigned char)symbols[n]] = n;
+	}
+
+	return gr;
+}
+
+bool grid_append_line(grid *gr, const char *line, size_t length)
+{
+	if (!gr || !gr->codes || !line) {
+		return false;
+	}
+
+	// Two codes to a byte, and a line may start halfway through one
+	size_t needed = (gr->used + length) / 2 + 1;
+	if (needed > gr->capacity) {
+		size_t capacity = gr->capacity;
+		while (capacity < needed) {
+			capacity *= 2;
+		}
+		unsigned char *codes = realloc(gr->codes, capacity);
+		if (!codes) {
+			return false;
+		}
+		gr->codes = codes;
+		gr->capacity = capacity;
+	}
+
+	size_t offset = gr->used;
+	for (size_t n = 0; n < length; ++n) {
+		unsigned char code = gr->code_of[(unsigned char)line[n]];
+		if (code == NO_CODE) {
+			return false;
+		}
+
+		size_t at = offset + n;
+		if (at % 2 == 0) {
+			gr->codes[at / 2] = code;
+		} else {
+			gr->codes[at / 2] = (gr->codes[at / 2] & 0xf) | code << 4;
+		}
+	}
+
+	if (!add_line(gr, offset, length)) {
+		return false;
+	}
+	gr->used += length;
+
+	return true;
+}
+
+size_t grid_width(const grid *gr)
+{
+	return gr ? gr->width : 0;
+}
+
+size_t grid_height(const grid *gr)
+{
+	return gr ? gr->height : 0;
+}
+
+char grid_cell(const grid *gr, size_t idx)
+{
+	if (gr->cells) {
+		return gr->cells[idx];
+	}
+
+	size_t row = idx / gr->width;
+	size_t col = idx % gr->width;
+	if (row == 0 || row >= gr->height - 1 || col == 0
+			|| col == gr->width - 1) {
+		return 'X';
+	}
+
+	// The ring takes up row and column 0
+	--row;
+	--col;
+	return col < gr->lengths[row] ? line_cell(gr, gr->offsets[row] + col)
+		: ' ';
+}
+
+void grid_copy_row(const grid *gr, size_t row, char *dest)
+{
+	if (gr->cells) {
+		memcpy(dest, gr->cells + row * gr->width, gr->width);
+		return;
+	} else if (row == 0 || row >= gr->height - 1) {
+		memset(dest, 'X', gr->width);
+		return;
+	}
+
+	size_t offset = gr->offsets[row - 1];
+	size_t length = gr->lengths[row - 1];
+	dest[0] = 'X';
+	if (gr->base) {
+		memcpy(dest + 1, gr->base + offset, length);
+	} else {
+		for (size_t n = 0; n < length; ++n) {
+			dest[n + 1] = line_cell(gr, offset + n);
+		}
+	}
+	memset(dest + 1 + length, ' ', gr->width - 2 - length);
+	dest[gr->width - 1] = 'X';
+}
+
+const char *grid_chars(const grid *gr)
+{
+	return gr ? gr->cells : NULL;
+}
+
+size_t grid_line(const grid *gr, size_t row, const char **line)
+{
+	if (!gr || !gr->base || row >= gr->lines) {
+		return 0;
+	}
+
+	if (line) {
+		*line = gr->base + gr->offsets[row];
+	}
+
+	return gr->lengths[row];
+}
+
+void grid_release(const grid *gr)
+{
+	if (gr && gr->base) {
+		release(gr, 0, gr->size);
+	}
+}
+
+void grid_destroy(grid *gr)
+{
+	if (!gr) {
+		return;
+	}
+
+	if (gr->base) {
+		// Only the mapping was ever const
+		munmap((void *)gr->base, gr->size);
+	}
+	free(gr->offsets);
+	free(gr->lengths);
+	free(gr->codes);
+	free(gr->cells);
+	free(gr);
+}
+
+static grid *grid_blank(size_t width, size_t height)
+{
+	grid *gr = malloc(sizeof(*gr));
+	if (!gr) {
+		return NULL;
+	}
+
+	gr->width = width;
+	gr->height = height;
+	gr->cells = NULL;
+	gr->offsets = NULL;
+	gr->lengths = NULL;
+	gr->lines = 0;
+	gr->line_capacity = 0;
+	gr->base = NULL;
+	gr->size = 0;
+	gr->codes = NULL;
+	gr->used = 0;
+	gr->capacity = 0;
+	gr->symbols[0] = '\0';
+
+	return gr;
+}
+
+// Indexes another line, growing the grid around it
+static bool add_line(grid *gr, size_t offset, size_t length)
+{
+	if (gr->lines == gr->line_capacity) {
+		size_t capacity = gr->line_capacity ? 2 * gr->line_capacity
+			: STARTING_LINES;
+		size_t *offsets = realloc(gr->offsets, capacity * sizeof(*offsets));
+		if (offsets) {
+			gr->offsets = offsets;
+		}
+		size_t *lengths = realloc(gr->lengths, capacity * sizeof(*lengths));
+		if (lengths) {
+			gr->lengths = lengths;
+		}
+		if (!offsets || !lengths) {
+			return false;
+		}
+		gr->line_capacity = capacity;
+	}
+
+	gr->offsets[gr->lines] = offset;
+	gr->lengths[gr->lines] = length;
+	++gr->lines;
+
+	// The ring adds a row or column on each side
+	gr->height = gr->lines + 2;
+	if (length + 2 > gr->width) {
+		gr->width = length + 2;
+	}
+
+	return true;
+}
+
+// Cell at offset at into the lines of a mapped or packed grid
+static char line_cell(const grid *gr, size_t at)
+{
+	if (gr->base) {
+		return gr->base[at];
+	}
+
+	return gr->symbols[(gr->codes[at / 2] >> (at % 2 * 4)) & 0xf];
+}
+
+// Drops the pages of the mapping from byte from up to byte to, leaving out
+// the pages either end shares with bytes outside
+static void release(const grid *gr, size_t from, size_t to)
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t first = (from + page - 1) / page * page;
+	size_t last = to == gr->size ? to : to / page * page;
+	if (first < last) {
+		madvise((void *)(gr->base + first), last - first, MADV_DONTNEED);
+	}
+}
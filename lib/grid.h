@@ -0,0 +1,60 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// The cells of a maze, width x height of them in row-major order: cell idx
+// sits at row idx / width and column idx % width.  The outermost rows and
+// columns are a ring of 'X' cells around the maze proper.
+typedef struct grid_ grid;
+
+// Takes over cells, which must already hold all width * height chars,
+// ring included; they are freed along with the grid
+grid *grid_create(char *cells, size_t width, size_t height);
+
+// Maps the file open on fd and reads its lines in place, so nothing is
+// copied and only the pages that get looked at are read in.  The ring
+// is implied, as are ' ' cells past the end of any line shorter than the
+// longest.  Returns NULL if the file cannot be mapped.
+grid *grid_map(int fd);
+
+// Packed grids hold up to this many different symbols
+#define GRID_PACKED_SYMBOLS 16
+
+// Creates an empty grid that stores each cell in 4 bits, as its place in
+// symbols, to be filled in a line at a time with grid_append_line.  As
+// with a mapped grid, the ring and the ' ' cells past the end of short
+// lines are implied; they need not be among the symbols.
+grid *grid_create_packed(const char *symbols);
+
+// Adds the length cells of line as the next row of a packed grid; returns
+// false if a cell is not among its symbols or memory runs out
+bool grid_append_line(grid *gr, const char *line, size_t length);
+
+size_t grid_width(const grid *gr);
+size_t grid_height(const grid *gr);
+
+// Returns the char at idx, which must be below width * height
+char grid_cell(const grid *gr, size_t idx);
+
+// Returns all the cells as one array, or NULL for a grid that does not
+// store them that way; cells are quickest to read through this
+const char *grid_chars(const grid *gr);
+
+// Copies the width cells of row into dest, ring included
+void grid_copy_row(const grid *gr, size_t row, char *dest);
+
+// Mapped grids only: points *line at line row of the file (counting from
+// 0, without the ring) and returns its length, not counting the newline
+size_t grid_line(const grid *gr, size_t row, const char **line);
+
+// Mapped grids only: lets the pages of the file read so far go, so that
+// they stop counting towards resident memory; cells on them are read back
+// in from the page cache as they are next looked at.  Other grids are left
+// as they are.
+void grid_release(const grid *gr);
+
+void grid_destroy(grid *gr);
+
+#endif
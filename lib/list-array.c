@@ -0,0 +1,210 @@
+#include "list.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Items sit side by side in items[start] up to items[start + sz - 1], with
+// free slots kept at both ends so that either can grow
+struct list_ {
+	void **items;
+	size_t start;
+	size_t sz;
+	size_t capacity;
+
+	void (*item_destroy)(void *);
+};
+
+enum { STARTING_CAPACITY = 8 };
+
+static bool make_room(list *l, size_t front, size_t back);
+
+list *list_create(void (*item_destroy)(void *))
+{
+	list *l = malloc(sizeof(*l));
+	if (!l) {
+		return NULL;
+	}
+
+	l->items = NULL;
+	l->start = 0;
+	l->sz = 0;
+	l->capacity = 0;
+	l->item_destroy = item_destroy;
+
+	return l;
+}
+
+// O(N)
+void list_destroy(list *l)
+{
+	if (!l) {
+		return;
+	}
+
+	if (l->item_destroy) {
+		for (size_t n=0; n < l->sz; ++n) {
+			l->item_destroy(l->items[l->start + n]);
+		}
+	}
+
+	free(l->items);
+	free(l);
+}
+
+// O(1)
+size_t list_size(const list *l)
+{
+	if (!l) {
+		return 0;
+	}
+
+	return l->sz;
+}
+
+// O(1)
+void *list_get(const list *l, size_t idx)
+{
+	if (!l || idx >= l->sz) {
+		return NULL;
+	}
+
+	return l->items[l->start + idx];
+}
+
+// O(1)
+void list_set(list *l, size_t idx, void *new_val)
+{
+	if (!l || idx >= l->sz) {
+		return;
+	}
+
+	l->items[l->start + idx] = new_val;
+}
+
+// Amortized O(1)
+void list_append(list *l, void *new_val)
+{
+	if (!l) {
+		return;
+	}
+
+	// Nothing holds an empty list's items in place, so all of its room
+	// can go to whichever end is used first
+	if (!l->sz) {
+		l->start = 0;
+	}
+	if (!make_room(l, 0, 1)) {
+		return;
+	}
+
+	l->items[l->start + l->sz] = new_val;
+	l->sz++;
+}
+
+// Amortized O(1)
+void list_prepend(list *l, void *new_val)
+{
+	if (!l) {
+		return;
+	}
+
+	if (!l->sz) {
+		l->start = l->capacity;
+	}
+	if (!make_room(l, 1, 0)) {
+		return;
+	}
+
+	l->start--;
+	l->items[l->start] = new_val;
+	l->sz++;
+}
+
+// An empty list sets aside count slots, to fill from either end; any other
+// has to make room at both, not knowing which end will grow
+void list_reserve(list *l, size_t count)
+{
+	if (!l || count <= l->sz) {
+		return;
+	}
+
+	if (l->sz) {
+		make_room(l, count - l->sz, count - l->sz);
+	} else if (count > l->capacity) {
+		void **items = malloc(count * sizeof(*items));
+		if (!items) {
+			return;
+		}
+
+		free(l->items);
+		l->items = items;
+		l->start = 0;
+		l->capacity = count;
+	}
+}
+
+// O(N)
+// O(1) overhead per item
+void list_iterate(list *l, void (*func)(void *))
+{
+	if (!l || !func) {
+		return;
+	}
+
+	for (size_t n=0; n < l->sz; ++n) {
+		func(l->items[l->start + n]);
+	}
+}
+
+void list_iterate_r(list *l, void (*func)(void *, void *), void *arg)
+{
+	if (!l || !func) {
+		return;
+	}
+
+	for (size_t n=0; n < l->sz; ++n) {
+		func(l->items[l->start + n], arg);
+	}
+}
+
+// Makes sure of at least front free slots before the items and back free
+// slots after them.  The end that ran short gets all the new room, so that
+// a run of prepends, or of appends, only moves the items log N times.
+static bool make_room(list *l, size_t front, size_t back)
+{
+	size_t has_front = l->start;
+	size_t has_back = l->capacity - l->start - l->sz;
+	if (has_front >= front && has_back >= back) {
+		return true;
+	}
+
+	size_t keep_front = has_front > front ? has_front : front;
+	size_t keep_back = has_back > back ? has_back : back;
+	size_t capacity = 2 * l->capacity;
+	if (capacity < STARTING_CAPACITY) {
+		capacity = STARTING_CAPACITY;
+	}
+	if (capacity < l->sz + keep_front + keep_back) {
+		capacity = l->sz + keep_front + keep_back;
+	}
+
+	void **items = malloc(capacity * sizeof(*items));
+	if (!items) {
+		return false;
+	}
+
+	size_t start = has_front < front ? capacity - l->sz - keep_back
+		: has_front;
+	if (l->sz) {
+		memcpy(items + start, l->items + l->start,
+				l->sz * sizeof(*items));
+	}
+
+	free(l->items);
+	l->items = items;
+	l->start = start;
+	l->capacity = capacity;
+
+	return true;
+}
@@ -148,6 +148,13 @@ void list_prepend(list *l, void *new_val)
 	l->head = new;
 }
 
+// Nodes are made one at a time as items arrive
+void list_reserve(list *l, size_t count)
+{
+	(void)l;
+	(void)count;
+}
+
 // O(N)
 // O(1) overhead per item
 void list_iterate(list *l, void (*func)(void *))
@@ -162,3 +169,16 @@ void list_iterate(list *l, void (*func)(void *))
 		curr = curr->next;
 	}
 }
+
+void list_iterate_r(list *l, void (*func)(void *, void *), void *arg)
+{
+	if (!l || !func) {
+		return;
+	}
+
+	struct node *curr = l->head;
+	while (curr) {
+		func(curr->data, arg);
+		curr = curr->next;
+	}
+}
@@ -21,7 +21,16 @@ void list_append(list *l, void *new_val);
 
 void list_prepend(list *l, void *new_val);
 
+// Hints that l is about to grow to count items, by appending, prepending or
+// both, so that room for them can be made once up front.  Implementations
+// with nothing to set aside ignore it.
+void list_reserve(list *l, size_t count);
+
 // Calls func() on each element in the list l
 void list_iterate(list *l, void (*func)(void *));
 
+// As list_iterate, but also hands func an arg that is passed through
+// untouched
+void list_iterate_r(list *l, void (*func)(void *, void *), void *arg);
+
 #endif
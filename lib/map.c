@@ -1,26 +1,59 @@
 #include "map.h"
 
-#include <math.h>
+#include <stdint.h>
 #include <string.h>
-#include <openssl/md5.h>
 
-struct node {
-	const char *key;
+// Keys shorter than this are kept in the slot itself, rather than copied out
+// to their own allocation
+enum { SHORT_KEY = 16 };
+
+// Slots sit side by side in one array, and a key that finds its slot taken
+// moves on to the next one (linear probing).  Nothing is ever removed, so
+// an empty slot always ends a probe.
+struct slot {
+	// 0 marks an empty slot; hash() never returns it
+	size_t hash;
+	size_t length;
 	void *value;
-	struct node *next;
+	union {
+		char text[SHORT_KEY];
+		char *copy;
+	} key;
 };
 
 struct map_ {
-	struct node **data;
+	struct slot *data;
+	size_t size;
+	// Always a power of 2, so that a hash is masked down to a slot
+	size_t capacity;
+};
+
+// Laid out and probed the same way; any key is valid, so emptiness is
+// marked separately
+struct u64_slot {
+	uint64_t key;
+	void *value;
+	bool used;
+};
+
+struct map_u64_ {
+	struct u64_slot *data;
 	size_t size;
 	size_t capacity;
 };
 
 // Seems like a reasonable starting size?
 // Seems like a reasonable load factor for a hashtable (out of 100)
-enum { STARTING_HASHTABLE_SIZE = 15, LOAD_FACTOR = 70 };
+enum { STARTING_HASHTABLE_SIZE = 16, LOAD_FACTOR = 70 };
 
-static size_t hash(const char *key, size_t capacity);
+static size_t hash(const char *key, size_t length);
+static const char *slot_key(const struct slot *s);
+static struct slot *find(const map *m, const char *key, size_t length,
+		size_t h);
+static bool grow(map *m);
+static size_t hash_u64(uint64_t key);
+static struct u64_slot *find_u64(const map_u64 *m, uint64_t key);
+static bool grow_u64(map_u64 *m);
 
 map *map_create(void)
 {
@@ -56,125 +89,275 @@ bool map_set(map *m, const char *key, void *value)
 		return false;
 	}
 
-	if (100 * m->size / m->capacity > LOAD_FACTOR) {
-		struct node **copy = calloc(2 * m->capacity, sizeof(*copy));
-		if (!copy) {
+	if (100 * (m->size + 1) / m->capacity > LOAD_FACTOR && !grow(m)) {
+		return false;
+	}
+
+	size_t length = strlen(key);
+	size_t h = hash(key, length);
+
+	struct slot *s = find(m, key, length, h);
+	if (s->hash) {
+		s->value = value;
+		return true;
+	}
+
+	if (length < SHORT_KEY) {
+		memcpy(s->key.text, key, length + 1);
+	} else {
+		s->key.copy = malloc(length + 1);
+		if (!s->key.copy) {
 			return false;
 		}
+		memcpy(s->key.copy, key, length + 1);
+	}
+
+	s->hash = h;
+	s->length = length;
+	s->value = value;
+	m->size++;
 
-		for (size_t n=0; n < m->capacity; ++n) {
-			struct node *curr = m->data[n];
-			while (curr) {
-				struct node *tmp = curr->next;
+	return true;
+}
 
-				// Doubled because the copy has twice as much capacity
-				size_t idx = hash(curr->key, 2 * m->capacity);
+void *map_get(const map *m, const char *key)
+{
+	if (!m || !key) {
+		return NULL;
+	}
 
-				curr->next = copy[idx];
-				copy[idx] = curr;
-				curr = tmp;
-			}
-		}
+	size_t length = strlen(key);
+	struct slot *s = find(m, key, length, hash(key, length));
 
-		m->capacity *= 2;
+	return s->hash ? s->value : NULL;
+}
 
-		free(m->data);
-		m->data = copy;
+void map_iterate(const map *m, void (*func)(const char *, void *))
+{
+	if (!m || !func) {
+		return;
 	}
 
-	size_t idx = hash(key, m->capacity);
+	for (size_t n=0; n < m->capacity; ++n) {
+		if (m->data[n].hash) {
+			func(slot_key(&m->data[n]), m->data[n].value);
+		}
+	}
+}
 
-	struct node *curr = m->data[idx];
-	while (curr) {
-		if (strcmp(curr->key, key) == 0) {
-			curr->value = value;
-			return true;
+void map_destroy(map *m)
+{
+	if (!m) {
+		return;
+	}
+
+	for (size_t n=0; n < m->capacity; ++n) {
+		// map owns the storage for each long key
+		if (m->data[n].hash && m->data[n].length >= SHORT_KEY) {
+			free(m->data[n].key.copy);
 		}
-		curr = curr->next;
 	}
 
-	struct node *new = malloc(sizeof(*new));
-	if (!new) {
-		return false;
+	free(m->data);
+	free(m);
+}
+
+map_u64 *map_u64_create(void)
+{
+	map_u64 *m = malloc(sizeof(*m));
+	if (!m) {
+		return NULL;
 	}
 
-	new->key = strdup(key);
-	new->value = value;
-	new->next = m->data[idx];
+	m->size = 0;
+	m->capacity = STARTING_HASHTABLE_SIZE;
 
-	m->data[idx] = new;
-	m->size++;
+	m->data = calloc(STARTING_HASHTABLE_SIZE, sizeof(*m->data));
+	if (!m->data) {
+		free(m);
+		return NULL;
+	}
 
-	return true;
+	return m;
 }
 
-void *map_get(const map *m, const char *key)
+size_t map_u64_size(const map_u64 *m)
 {
-	if (!m || !key) {
-		return NULL;
+	if (!m) {
+		return 0;
 	}
 
-	size_t idx = hash(key, m->capacity);
+	return m->size;
+}
 
-	struct node *curr = m->data[idx];
-	while (curr) {
-		if (strcmp(curr->key, key) == 0) {
-			return curr->value;
-		}
+bool map_u64_set(map_u64 *m, uint64_t key, void *value)
+{
+	if (!m) {
+		return false;
+	}
 
-		curr = curr->next;
+	if (100 * (m->size + 1) / m->capacity > LOAD_FACTOR && !grow_u64(m)) {
+		return false;
 	}
 
-	return NULL;
+	struct u64_slot *s = find_u64(m, key);
+	if (!s->used) {
+		s->key = key;
+		s->used = true;
+		m->size++;
+	}
+	s->value = value;
+
+	return true;
 }
 
-void map_iterate(const map *m, void (*func)(const char *, void *))
+void *map_u64_get(const map_u64 *m, uint64_t key)
+{
+	if (!m) {
+		return NULL;
+	}
+
+	struct u64_slot *s = find_u64(m, key);
+
+	return s->used ? s->value : NULL;
+}
+
+void map_u64_iterate(const map_u64 *m, void (*func)(uint64_t, void *))
 {
 	if (!m || !func) {
 		return;
 	}
 
 	for (size_t n=0; n < m->capacity; ++n) {
-		struct node *curr = m->data[n];
-		while (curr) {
-			func(curr->key, curr->value);
-			curr = curr->next;
+		if (m->data[n].used) {
+			func(m->data[n].key, m->data[n].value);
 		}
 	}
-
 }
 
-void map_destroy(map *m)
+void map_u64_destroy(map_u64 *m)
 {
 	if (!m) {
 		return;
 	}
 
+	free(m->data);
+	free(m);
+}
+
+// FNV-1a, with the high bits folded back in since only the low ones pick
+// a slot
+static size_t hash(const char *key, size_t length)
+{
+	uint64_t h = 14695981039346656037u;
+	for (size_t n=0; n < length; ++n) {
+		h ^= (unsigned char)key[n];
+		h *= 1099511628211u;
+	}
+	h ^= h >> 32;
+
+	size_t folded = (size_t)h;
+	return folded ? folded : 1;
+}
+
+static const char *slot_key(const struct slot *s)
+{
+	return s->length < SHORT_KEY ? s->key.text : s->key.copy;
+}
+
+// Returns the slot holding key, or the empty slot it would go in
+static struct slot *find(const map *m, const char *key, size_t length,
+		size_t h)
+{
+	size_t mask = m->capacity - 1;
+	for (size_t idx = h & mask; ; idx = (idx + 1) & mask) {
+		struct slot *s = &m->data[idx];
+		if (!s->hash || (s->hash == h && s->length == length
+				&& memcmp(slot_key(s), key, length) == 0)) {
+			return s;
+		}
+	}
+}
+
+// Doubles the table, moving every slot over whole; short keys go with their
+// slot and long ones keep their copy
+static bool grow(map *m)
+{
+	struct slot *copy = calloc(2 * m->capacity, sizeof(*copy));
+	if (!copy) {
+		return false;
+	}
+
+	size_t mask = 2 * m->capacity - 1;
 	for (size_t n=0; n < m->capacity; ++n) {
-		struct node *curr = m->data[n];
-		while (curr) {
-			// map owns the storage for each key via strdup
-			// Safe to cast away const-ness
-			free((char *)curr->key);
-			struct node *to_free = curr;
-			curr = curr->next;
-			free(to_free);
+		if (!m->data[n].hash) {
+			continue;
+		}
+
+		size_t idx = m->data[n].hash & mask;
+		while (copy[idx].hash) {
+			idx = (idx + 1) & mask;
 		}
+		copy[idx] = m->data[n];
 	}
 
+	m->capacity *= 2;
+
 	free(m->data);
-	free(m);
+	m->data = copy;
+
+	return true;
 }
 
-static size_t hash(const char *key, size_t capacity)
+// The finalizer of MurmurHash3, which spreads every bit of the key across
+// the low ones that pick a slot; ids and aligned addresses vary mostly in
+// their middle bits
+static size_t hash_u64(uint64_t key)
 {
-	union {
-		unsigned char buffer[MD5_DIGEST_LENGTH];
-		size_t index;
-	} result;
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdu;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53u;
+	key ^= key >> 33;
 
-	// MD5 takes array of bytes, and a string is an array of bytes
-	MD5((const unsigned char *)key, strlen(key), result.buffer);
+	return (size_t)key;
+}
 
-	return result.index % capacity;
+static struct u64_slot *find_u64(const map_u64 *m, uint64_t key)
+{
+	size_t mask = m->capacity - 1;
+	for (size_t idx = hash_u64(key) & mask; ; idx = (idx + 1) & mask) {
+		struct u64_slot *s = &m->data[idx];
+		if (!s->used || s->key == key) {
+			return s;
+		}
+	}
+}
+
+static bool grow_u64(map_u64 *m)
+{
+	struct u64_slot *copy = calloc(2 * m->capacity, sizeof(*copy));
+	if (!copy) {
+		return false;
+	}
+
+	size_t mask = 2 * m->capacity - 1;
+	for (size_t n=0; n < m->capacity; ++n) {
+		if (!m->data[n].used) {
+			continue;
+		}
+
+		size_t idx = hash_u64(m->data[n].key) & mask;
+		while (copy[idx].used) {
+			idx = (idx + 1) & mask;
+		}
+		copy[idx] = m->data[n];
+	}
+
+	m->capacity *= 2;
+
+	free(m->data);
+	m->data = copy;
+
+	return true;
 }
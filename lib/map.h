@@ -2,6 +2,7 @@
 #define MAP_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 typedef struct map_ map;
@@ -19,5 +20,22 @@ void map_iterate(const map *m, void (*func)(const char *, void *));
 
 void map_destroy(map *m);
 
+// The same, but keyed by 64-bit integers (ids, or addresses cast to
+// uintptr_t), which are hashed and stored as they are, with no strings
+// formatted or copied
+typedef struct map_u64_ map_u64;
+
+map_u64 *map_u64_create(void);
+
+size_t map_u64_size(const map_u64 *m);
+
+bool map_u64_set(map_u64 *m, uint64_t key, void *value);
+
+void *map_u64_get(const map_u64 *m, uint64_t key);
+
+void map_u64_iterate(const map_u64 *m, void (*func)(uint64_t, void *));
+
+void map_u64_destroy(map_u64 *m);
+
 
 #endif
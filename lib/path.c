@@ -1,91 +1,1545 @@
 #include "path.h"
 
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "map.h"
 #include "pqueue.h"
 
-static const graph *dijkstra_graph;
-static pqueue *to_process;
-static map *previous;
-static map *distance_from_origin;
-static const void *curr_item;
-static double priority;
+struct dijkstra_ctx_ {
+	const graph *g;
+	pqueue *to_process;
+
+	// Graphs with ids keep distances and previous hops in flat arrays;
+	// touched lists the ids a search has written to, so that only those
+	// need resetting before the next one.  Previous hops are stored off
+	// by one, so zeroed memory reads as unreached and a page of these
+	// is only ever touched once a search gets to it.  A search that
+	// reaches more ids than touched holds is cheaper to undo by clearing
+	// the lot, so touched stops at a share of them.
+	size_t count;
+	double *distance;
+	size_t *previous;
+	size_t *touched;
+	size_t touched_count;
+	size_t touched_capacity;
+	bool touched_all;
+
+	// Compact contexts on grid graphs keep these instead of distance and
+	// previous, until a distance turns up that they cannot hold.
+	// half_steps holds twice the distance plus one, so that 0 still reads
+	// as unreached; steps holds which neighbor the previous hop is, 2 bits
+	// a cell.  The start's own step is never read.
+	uint32_t *half_steps;
+	unsigned char *steps;
+	size_t width;
+	size_t start;
+
+	// Any other graph is keyed by node address, one search at a time
+	map_u64 *previous_map;
+	map_u64 *distance_map;
+
+	// Set for A*, which adds the estimate to go to each priority
+	path_heuristic_func heuristic;
+	void *heuristic_arg;
+	const void *goal;
+
+	// Node being expanded, and its distance from the start
+	size_t curr;
+	const void *curr_item;
+	double curr_distance;
+
+	// Set when a node reached could not be queued for want of memory,
+	// which cuts the search short; what it found is then no good
+	bool failed;
+};
+
+// Searches that reach more than 1 / TOUCHED_SHARE of the ids are undone by
+// clearing every previous hop rather than the ones listed
+enum { TOUCHED_SHARE = 16 };
+
+// Where a compact context's previous hop is, from the cell it belongs to
+enum { STEP_LEFT, STEP_RIGHT, STEP_UP, STEP_DOWN, STEPS_PER_BYTE = 4 };
+
+// What the searches run on each thread have done; counting is a handful
+// of increments per node, cheap enough to leave on all the time
+static _Thread_local struct path_stats stats;
 
 union double_pointer {
 	double d;
 	void *p;
 };
 
-static void add_to_pqueue_if_faster(const void *neighbor)
+// The queue cannot hold NULL, so ids go in off by one
+static void *id_as_item(size_t id)
+{
+	return (void *)(uintptr_t)(id + 1);
+}
+
+static size_t item_as_id(const void *item)
+{
+	return (uintptr_t)item - 1;
+}
+
+static dijkstra_ctx *ctx_create(const graph *g, bool compact);
+static bool widen(dijkstra_ctx *ctx);
+
+dijkstra_ctx *dijkstra_ctx_create(const graph *g)
+{
+	return ctx_create(g, false);
+}
+
+dijkstra_ctx *dijkstra_ctx_create_compact(const graph *g)
+{
+	return ctx_create(g, graph_grid_width(g) > 0);
+}
+
+static dijkstra_ctx *ctx_create(const graph *g, bool compact)
 {
-	char *nbr_str = malloc(sizeof(*nbr_str) * 20);
-	snprintf(nbr_str, 20, "%ld", (long)neighbor);
+	if (!g) {
+		return NULL;
+	}
+
+	dijkstra_ctx *ctx = malloc(sizeof(*ctx));
+	if (!ctx) {
+		return NULL;
+	}
+
+	ctx->g = g;
+	ctx->to_process = pqueue_create(BUCKET_PQUEUE);
+	ctx->count = graph_id_bound(g);
+	ctx->distance = NULL;
+	ctx->previous = NULL;
+	ctx->half_steps = NULL;
+	ctx->steps = NULL;
+	ctx->width = graph_grid_width(g);
+	ctx->start = 0;
+	bool tables;
+	if (compact) {
+		ctx->half_steps = calloc(ctx->count + 1, sizeof(*ctx->half_steps));
+		ctx->steps = calloc(ctx->count / STEPS_PER_BYTE + 1,
+				sizeof(*ctx->steps));
+		tables = ctx->half_steps && ctx->steps;
+	} else {
+		ctx->distance = calloc(ctx->count + 1, sizeof(*ctx->distance));
+		ctx->previous = calloc(ctx->count + 1, sizeof(*ctx->previous));
+		tables = ctx->distance && ctx->previous;
+	}
+	ctx->touched_capacity = ctx->count / TOUCHED_SHARE + 1;
+	ctx->touched = malloc(ctx->touched_capacity * sizeof(*ctx->touched));
+	ctx->touched_count = 0;
+	ctx->touched_all = false;
+	ctx->failed = false;
+	ctx->previous_map = NULL;
+	ctx->distance_map = NULL;
+	ctx->heuristic = NULL;
+	ctx->heuristic_arg = NULL;
+	ctx->goal = NULL;
+	if (!ctx->to_process || !tables || !ctx->touched) {
+		dijkstra_ctx_destroy(ctx);
+		return NULL;
+	}
 
-	double weight =
-	    graph_get_edge_weight(dijkstra_graph, curr_item, neighbor);
-	double distance = weight + priority;
+	return ctx;
+}
+
+void dijkstra_ctx_set_heuristic(dijkstra_ctx *ctx, path_heuristic_func h,
+		void *arg)
+{
+	if (!ctx) {
+		return;
+	}
+
+	ctx->heuristic = h;
+	ctx->heuristic_arg = arg;
+}
+
+void dijkstra_ctx_destroy(dijkstra_ctx *ctx)
+{
+	if (!ctx) {
+		return;
+	}
+
+	stats.stale += pqueue_stale_count(ctx->to_process);
+	if (pqueue_peak_size(ctx->to_process) > stats.peak_queued) {
+		stats.peak_queued = pqueue_peak_size(ctx->to_process);
+	}
+
+	pqueue_destroy(ctx->to_process);
+	free(ctx->distance);
+	free(ctx->previous);
+	free(ctx->half_steps);
+	free(ctx->steps);
+	free(ctx->touched);
+	free(ctx);
+}
+
+static void *dequeue(dijkstra_ctx *ctx)
+{
+	stats.dequeued++;
+	return pqueue_dequeue(ctx->to_process, NULL);
+}
+
+// Estimated cost still to go from data to the goal; 0 for plain Dijkstra
+static double estimate(const dijkstra_ctx *ctx, const void *data)
+{
+	if (!ctx->heuristic) {
+		return 0;
+	}
+
+	return ctx->heuristic(data, ctx->goal, ctx->heuristic_arg);
+}
+
+// Queues item at priority, or moves it up if it is already queued
+static void queue(dijkstra_ctx *ctx, void *item, double priority)
+{
+	if (pqueue_decrease_priority(ctx->to_process, item, priority)
+			|| pqueue_contains(ctx->to_process, item)) {
+		return;
+	}
+
+	if (!pqueue_enqueue(ctx->to_process, priority, item)) {
+		ctx->failed = true;
+	}
+}
+
+// Notes that the search has given id a previous hop
+static void touch(dijkstra_ctx *ctx, size_t id)
+{
+	if (ctx->touched_count < ctx->touched_capacity) {
+		ctx->touched[ctx->touched_count++] = id;
+	} else {
+		ctx->touched_all = true;
+	}
+}
+
+static double distance_to(const dijkstra_ctx *ctx, size_t id)
+{
+	if (ctx->half_steps) {
+		return ctx->half_steps[id] ? (ctx->half_steps[id] - 1) * 0.5
+			: INFINITY;
+	}
+
+	return ctx->previous[id] ? ctx->distance[id] : INFINITY;
+}
+
+// GRAPH_NO_ID if the search has not reached id
+static size_t previous_hop(const dijkstra_ctx *ctx, size_t id)
+{
+	if (ctx->half_steps) {
+		if (!ctx->half_steps[id]) {
+			return GRAPH_NO_ID;
+		}
+
+		unsigned step = ctx->steps[id / STEPS_PER_BYTE]
+			>> (id % STEPS_PER_BYTE * 2) & 3;
+		switch (step) {
+		case STEP_LEFT:
+			return id - 1;
+		case STEP_RIGHT:
+			return id + 1;
+		case STEP_UP:
+			return id - ctx->width;
+		default:
+			return id + ctx->width;
+		}
+	}
+
+	return ctx->previous[id] - 1;
+}
+
+// Which step leads back from id to from in a compact context, or
+// STEPS_PER_BYTE if from is not beside it
+static unsigned step_between(const dijkstra_ctx *ctx, size_t id,
+		size_t from)
+{
+	if (from + 1 == id) {
+		return STEP_LEFT;
+	} else if (id + 1 == from) {
+		return STEP_RIGHT;
+	} else if (from + ctx->width == id) {
+		return STEP_UP;
+	} else if (id + ctx->width == from) {
+		return STEP_DOWN;
+	}
+
+	return STEPS_PER_BYTE;
+}
+
+// Records that the search has got to id at distance, by way of from
+static void reach(dijkstra_ctx *ctx, size_t id, double distance, size_t from)
+{
+	if (ctx->half_steps) {
+		double half = 2 * distance + 1;
+		unsigned step = from == id ? STEP_LEFT
+			: step_between(ctx, id, from);
+		if (half < UINT32_MAX && !(half > (uint32_t)half)
+				&& step < STEPS_PER_BYTE) {
+			if (!ctx->half_steps[id]) {
+				touch(ctx, id);
+			}
+			ctx->half_steps[id] = (uint32_t)half;
+
+			unsigned shift = id % STEPS_PER_BYTE * 2;
+			unsigned char *byte = &ctx->steps[id / STEPS_PER_BYTE];
+			*byte = (*byte & ~(3u << shift)) | step << shift;
+			return;
+		}
+
+		// Case: the compact tables cannot hold this, so give them up
+		if (!widen(ctx)) {
+			return;
+		}
+	}
+
+	if (!ctx->previous[id]) {
+		touch(ctx, id);
+	}
+	ctx->distance[id] = distance;
+	ctx->previous[id] = from + 1;
+}
+
+// Moves a compact context over to the usual tables, keeping what the
+// search in progress has found; false if memory runs out
+static bool widen(dijkstra_ctx *ctx)
+{
+	ctx->distance = calloc(ctx->count + 1, sizeof(*ctx->distance));
+	ctx->previous = calloc(ctx->count + 1, sizeof(*ctx->previous));
+	if (!ctx->distance || !ctx->previous) {
+		free(ctx->distance);
+		free(ctx->previous);
+		ctx->distance = NULL;
+		ctx->previous = NULL;
+		ctx->failed = true;
+		return false;
+	}
+
+	size_t count = ctx->touched_all ? ctx->count : ctx->touched_count;
+	for (size_t n=0; n < count; ++n) {
+		size_t id = ctx->touched_all ? n : ctx->touched[n];
+		if (ctx->half_steps[id]) {
+			ctx->distance[id] = distance_to(ctx, id);
+			ctx->previous[id] = (id == ctx->start ? id
+					: previous_hop(ctx, id)) + 1;
+		}
+	}
+
+	free(ctx->half_steps);
+	free(ctx->steps);
+	ctx->half_steps = NULL;
+	ctx->steps = NULL;
+
+	return true;
+}
+
+static void relax_if_faster(size_t neighbor, double weight, void *arg)
+{
+	dijkstra_ctx *ctx = arg;
+
+	stats.relaxed++;
+	double distance = ctx->curr_distance + weight;
+	if (distance < distance_to(ctx, neighbor)) {
+		reach(ctx, neighbor, distance, ctx->curr);
+		if (ctx->failed) {
+			return;
+		}
+
+		double priority = distance
+			+ estimate(ctx, graph_node_data(ctx->g, neighbor));
+		queue(ctx, id_as_item(neighbor), priority);
+	}
+}
+
+// Clears whatever the last search left behind
+static void reset(dijkstra_ctx *ctx)
+{
+	while (!pqueue_is_empty(ctx->to_process)) {
+		pqueue_dequeue(ctx->to_process, NULL);
+	}
+
+	if (ctx->half_steps && ctx->touched_all) {
+		memset(ctx->half_steps, 0, ctx->count * sizeof(*ctx->half_steps));
+	} else if (ctx->half_steps) {
+		for (size_t n=0; n < ctx->touched_count; ++n) {
+			ctx->half_steps[ctx->touched[n]] = 0;
+		}
+	} else if (ctx->touched_all) {
+		memset(ctx->previous, 0, ctx->count * sizeof(*ctx->previous));
+	} else {
+		for (size_t n=0; n < ctx->touched_count; ++n) {
+			ctx->previous[ctx->touched[n]] = 0;
+		}
+	}
+	ctx->touched_count = 0;
+	ctx->touched_all = false;
+	ctx->failed = false;
+}
+
+// Queues start as the only node reached so far
+static void begin(dijkstra_ctx *ctx, size_t start)
+{
+	reset(ctx);
+	// The start is its own previous hop, which marks it as touched
+	ctx->start = start;
+	reach(ctx, start, 0, start);
+	queue(ctx, id_as_item(start), 0);
+}
+
+// Settles nodes out from start until end comes off the queue; with
+// end=GRAPH_NO_ID, goes on until every node start can reach is settled
+static void settle(dijkstra_ctx *ctx, size_t start, size_t end)
+{
+	begin(ctx, start);
+	ctx->goal = end == GRAPH_NO_ID ? NULL : graph_node_data(ctx->g, end);
+
+	while (!ctx->failed && !pqueue_is_empty(ctx->to_process)) {
+		ctx->curr = item_as_id(dequeue(ctx));
+		ctx->curr_distance = distance_to(ctx, ctx->curr);
+		if (ctx->curr == end) {
+			break;
+		}
+
+		stats.expanded++;
+		graph_iterate_neighbor_ids(ctx->g, ctx->curr, relax_if_faster, ctx);
+	}
+}
+
+// Fills results with the path from start to end that the last search
+// found, if it reached end at all; false if the list ran out of memory
+// part way
+static bool trace(const dijkstra_ctx *ctx, size_t start, size_t end,
+		list *results)
+{
+	if (previous_hop(ctx, end) == GRAPH_NO_ID) {
+		return true;
+	}
+
+	// Counting the hops first costs a walk along the path, and lets the
+	// list make room for all of them at once
+	size_t hops = 0;
+	for (size_t curr = end; curr != start; curr = previous_hop(ctx, curr)) {
+		++hops;
+	}
+	list_reserve(results, hops);
+
+	for (size_t curr = end; curr != start; curr = previous_hop(ctx, curr)) {
+		list_prepend(results, graph_node_data(ctx->g, curr));
+	}
+
+	return list_size(results) == hops;
+}
+
+list *dijkstra_ctx_path_ids(dijkstra_ctx *ctx, size_t start, size_t end)
+{
+	if (!ctx) {
+		return NULL;
+	}
+
+	// Results are borrowed from the graph
+	list *results = list_create(NULL);
+	if (!results || start >= ctx->count || end >= ctx->count) {
+		return results;
+	}
+
+	settle(ctx, start, end);
+	if (ctx->failed || !trace(ctx, start, end, results)) {
+		list_destroy(results);
+		return NULL;
+	}
+
+	return results;
+}
+
+static void add_to_pqueue_if_faster(const void *neighbor, double weight,
+		void *arg)
+{
+	dijkstra_ctx *ctx = arg;
+
+	stats.relaxed++;
+	uint64_t key = (uintptr_t)neighbor;
+
+	double distance = weight + ctx->curr_distance;
 
 	union double_pointer current_best = {.p =
-		    map_get(distance_from_origin, nbr_str)
+		    map_u64_get(ctx->distance_map, key)
 	};
 
-	if (!map_get(previous, nbr_str)) {
-		// Nothing in Dijkstra's changes these items or neighbors; this cast is safe
-		map_set(previous, nbr_str, (void *)curr_item);
-		// Nothing in Dijkstra's changes these items or neighbors; this cast is safe
-		pqueue_enqueue(to_process, distance, (void *)neighbor);
-
+	if (!map_u64_get(ctx->previous_map, key)
+			|| distance < current_best.d) {
 		current_best.d = distance;
-		map_set(distance_from_origin, nbr_str, current_best.p);
-	} else if (distance < current_best.d) {
 		// Nothing in Dijkstra's changes these items or neighbors; this cast is safe
-		map_set(previous, nbr_str, (void *)curr_item);
-		// Nothing in Dijkstra's changes these items or neighbors; this cast is safe
-		pqueue_enqueue(to_process, distance, (void *)neighbor);
+		if (!map_u64_set(ctx->previous_map, key, (void *)ctx->curr_item)
+				|| !map_u64_set(ctx->distance_map, key,
+					current_best.p)) {
+			ctx->failed = true;
+			return;
+		}
 
-		current_best.d = distance;
-		map_set(distance_from_origin, nbr_str, current_best.p);
+		double priority = distance + estimate(ctx, neighbor);
+		// Nothing in Dijkstra's changes these items or neighbors; this cast is safe
+		queue(ctx, (void *)neighbor, priority);
 	}
-	free(nbr_str);
 }
 
-list *dijkstra_path(const graph * g, const void *start, const void *end)
+list *dijkstra_ctx_path(dijkstra_ctx *ctx, const void *start, const void *end)
 {
-	// Results are borrowed from the graph g
+	if (!ctx) {
+		return NULL;
+	}
+
+	size_t start_id = graph_node_id(ctx->g, start);
+	size_t end_id = graph_node_id(ctx->g, end);
+	if (start_id != GRAPH_NO_ID && end_id != GRAPH_NO_ID) {
+		return dijkstra_ctx_path_ids(ctx, start_id, end_id);
+	}
+
+	// Results are borrowed from the graph
 	list *results = list_create(NULL);
+	if (!results) {
+		return NULL;
+	}
+
+	reset(ctx);
+	ctx->goal = end;
+	// Nodes are keyed by their address
+	ctx->previous_map = map_u64_create();
+	ctx->distance_map = map_u64_create();
+	ctx->failed = !ctx->previous_map || !ctx->distance_map
+		|| !map_u64_set(ctx->previous_map, (uintptr_t)start, NULL);
+
+	if (!ctx->failed) {
+		// Nothing in Dijkstra's changes these items or neighbors; this cast is safe
+		queue(ctx, (void *)start, 0);
+	}
+	while (!ctx->failed && !pqueue_is_empty(ctx->to_process)) {
+		ctx->curr_item = dequeue(ctx);
 
-	dijkstra_graph = g;
-
-	to_process = pqueue_create(MIN_PQUEUE);
-	previous = map_create();
-	distance_from_origin = map_create();
-	char *start_str = malloc(sizeof(*start_str) * 20);
-	snprintf(start_str, 20, "%ld", (long)start);
-	// Nothing in Dijkstra's changes these items or neighbors; this cast is safe
-	pqueue_enqueue(to_process, 0, (void *)start);
-	map_set(previous, start_str, NULL);
-	free(start_str);
-	while (!pqueue_is_empty(to_process)) {
-		curr_item = pqueue_dequeue(to_process, &priority);
-
-		if (curr_item == end) {
+		if (ctx->curr_item == end) {
 			break;
 		}
-		graph_iterate_neighbors(g, curr_item, add_to_pqueue_if_faster);
+
+		// Priorities may include an estimate, so look up the real distance
+		ctx->curr_distance = 0;
+		if (ctx->curr_item != start) {
+			union double_pointer best = {.p =
+				map_u64_get(ctx->distance_map,
+						(uintptr_t)ctx->curr_item)
+			};
+			ctx->curr_distance = best.d;
+		}
+		stats.expanded++;
+		graph_iterate_neighbors_r(ctx->g, ctx->curr_item,
+				add_to_pqueue_if_faster, ctx);
 
 	}
 	const void *curr = end;
+	if (ctx->failed) {
+		list_destroy(results);
+		results = NULL;
+		curr = NULL;
+	} else if (!map_u64_get(ctx->previous_map, (uintptr_t)end)) {
+		// Case: end was never reached, so there is no path to give back
+		curr = NULL;
+	}
+	size_t hops = 0;
 	while (curr != start && curr != NULL) {
 		// Nothing in Dijkstra's changes these items or neighbors, but the graph owner
 		// may want to, so this cast is safe
 		list_prepend(results, (void *)curr);
-		char *curr_str = malloc(sizeof(*curr_str) * 20);
-		snprintf(curr_str, 20, "%ld", (long)curr);
-		curr = map_get(previous, curr_str);
-		free(curr_str);
+		curr = map_u64_get(ctx->previous_map, (uintptr_t)curr);
+		++hops;
+	}
+	if (list_size(results) != hops) {
+		// Case: the list ran out of memory part way along the path
+		list_destroy(results);
+		results = NULL;
+	}
+	map_u64_destroy(ctx->distance_map);
+	map_u64_destroy(ctx->previous_map);
+	ctx->distance_map = NULL;
+	ctx->previous_map = NULL;
+
+	return results;
+}
+
+// A bidirectional search grows one context out from the start over the
+// edges, and another back from the end over the same edges reversed
+struct meeting {
+	dijkstra_ctx *sides[2];
+	size_t side;
+
+	// Cheapest path seen between the two sides, and the node it goes via
+	double best;
+	size_t via;
+};
+
+static void relax_and_meet(size_t neighbor, double weight, void *arg)
+{
+	struct meeting *m = arg;
+	dijkstra_ctx *ctx = m->sides[m->side];
+	const dijkstra_ctx *other = m->sides[!m->side];
+
+	relax_if_faster(neighbor, weight, ctx);
+
+	double through = distance_to(ctx, neighbor)
+		+ distance_to(other, neighbor);
+	if (through < m->best) {
+		m->best = through;
+		m->via = neighbor;
+	}
+}
+
+// Runs both sides until they are known to have met on a cheapest path
+static void meet(struct meeting *m, size_t start, size_t end)
+{
+	dijkstra_ctx *forward = m->sides[0];
+	dijkstra_ctx *backward = m->sides[1];
+
+	begin(forward, start);
+	begin(backward, end);
+
+	// Each side settles nodes in order of distance, so once the last two
+	// settled add up to the best path seen, nothing cheaper is left.  If
+	// either side runs dry, it has already met everything it can reach.
+	double radius[2] = { 0, 0 };
+	while (!forward->failed && !backward->failed
+			&& !pqueue_is_empty(forward->to_process)
+			&& !pqueue_is_empty(backward->to_process)) {
+		dijkstra_ctx *ctx = m->sides[m->side];
+		ctx->curr = item_as_id(dequeue(ctx));
+		ctx->curr_distance = distance_to(ctx, ctx->curr);
+
+		radius[m->side] = ctx->curr_distance;
+		if (radius[0] + radius[1] >= m->best) {
+			break;
+		}
+
+		stats.expanded++;
+		if (ctx == forward) {
+			graph_iterate_neighbor_ids(ctx->g, ctx->curr, relax_and_meet, m);
+		} else {
+			graph_iterate_in_neighbor_ids(ctx->g, ctx->curr, relax_and_meet,
+					m);
+		}
+		m->side = !m->side;
+	}
+}
+
+list *bidirectional_path_ids(const graph *g, size_t start, size_t end)
+{
+	struct meeting m = {
+		.sides = { dijkstra_ctx_create(g), dijkstra_ctx_create(g) },
+		.side = 0,
+		.best = INFINITY,
+		.via = GRAPH_NO_ID
+	};
+	dijkstra_ctx *forward = m.sides[0];
+	dijkstra_ctx *backward = m.sides[1];
+
+	// Results are borrowed from the graph
+	list *results = forward && backward ? list_create(NULL) : NULL;
+	if (results && start < forward->count && end < forward->count
+			&& start != end) {
+		meet(&m, start, end);
+		if (forward->failed || backward->failed) {
+			list_destroy(results);
+			results = NULL;
+		}
+	}
+
+	if (results && m.via != GRAPH_NO_ID) {
+		size_t hops = 0;
+		for (size_t curr = m.via; curr != start;
+				curr = previous_hop(forward, curr)) {
+			list_prepend(results, graph_node_data(g, curr));
+			++hops;
+		}
+		// Backward previous hops lead on towards the end
+		for (size_t curr = m.via; curr != end; ++hops) {
+			curr = previous_hop(backward, curr);
+			list_append(results, graph_node_data(g, curr));
+		}
+
+		if (list_size(results) != hops) {
+			list_destroy(results);
+			results = NULL;
+		}
+	}
+
+	dijkstra_ctx_destroy(forward);
+	dijkstra_ctx_destroy(backward);
+
+	return results;
+}
+
+list *bidirectional_path(const graph *g, const void *start, const void *end)
+{
+	size_t start_id = graph_node_id(g, start);
+	size_t end_id = graph_node_id(g, end);
+	if (start_id == GRAPH_NO_ID || end_id == GRAPH_NO_ID) {
+		// Without ids there are no reverse edges to follow
+		return dijkstra_path(g, start, end);
+	}
+
+	return bidirectional_path_ids(g, start_id, end_id);
+}
+
+list *dijkstra_path_ids(const graph *g, size_t start, size_t end)
+{
+	dijkstra_ctx *ctx = dijkstra_ctx_create(g);
+	list *results = dijkstra_ctx_path_ids(ctx, start, end);
+	dijkstra_ctx_destroy(ctx);
+
+	return results;
+}
+
+list *dijkstra_path(const graph *g, const void *start, const void *end)
+{
+	dijkstra_ctx *ctx = dijkstra_ctx_create(g);
+	list *results = dijkstra_ctx_path(ctx, start, end);
+	dijkstra_ctx_destroy(ctx);
+
+	return results;
+}
+
+list *astar_path(const graph *g, const void *start, const void *end,
+		path_heuristic_func h, void *arg)
+{
+	dijkstra_ctx *ctx = dijkstra_ctx_create(g);
+	dijkstra_ctx_set_heuristic(ctx, h, arg);
+	list *results = dijkstra_ctx_path(ctx, start, end);
+	dijkstra_ctx_destroy(ctx);
+
+	return results;
+}
+
+list *astar_path_ids(const graph *g, size_t start, size_t end,
+		path_heuristic_func h, void *arg)
+{
+	dijkstra_ctx *ctx = dijkstra_ctx_create(g);
+	dijkstra_ctx_set_heuristic(ctx, h, arg);
+	list *results = dijkstra_ctx_path_ids(ctx, start, end);
+	dijkstra_ctx_destroy(ctx);
+
+	return results;
+}
+
+// Jump point search walks grid graphs along canonical paths, which take
+// any horizontal steps before vertical ones.  A vertical run only turns
+// where it has to: where the cell beside the one it came from is a wall,
+// or costs more than the cell it turns from, so that no path of the same
+// cost went that way first.  Runs between the nodes that get queued are
+// walked without queueing anything, which is what pays off on open maps.
+enum {
+	JUMP_DOWN = 1,
+	JUMP_RIGHT = 2,
+	JUMP_UP = 4,
+	JUMP_LEFT = 8
+};
+
+struct jumper {
+	dijkstra_ctx *ctx;
+	size_t width;
+	size_t end;
+
+	// Directions each node was reached in at its best distance so far;
+	// a node reached several ways at the same cost expands for all of them
+	unsigned char *arrivals;
+};
+
+static bool is_vertical(unsigned dir)
+{
+	return dir == JUMP_DOWN || dir == JUMP_UP;
+}
+
+static unsigned opposite(unsigned dir)
+{
+	return dir < JUMP_UP ? dir << 2 : dir >> 2;
+}
+
+// The id one step from id in dir, or GRAPH_NO_ID off the edge of the grid
+static size_t step(const struct jumper *j, size_t id, unsigned dir)
+{
+	switch (dir) {
+	case JUMP_DOWN:
+		return id + j->width < j->ctx->count ? id + j->width : GRAPH_NO_ID;
+	case JUMP_RIGHT:
+		return (id + 1) % j->width ? id + 1 : GRAPH_NO_ID;
+	case JUMP_UP:
+		return id >= j->width ? id - j->width : GRAPH_NO_ID;
+	default:
+		return id % j->width ? id - 1 : GRAPH_NO_ID;
+	}
+}
+
+// 0 for walls and anything off the grid; weights are never negative
+static double cost(const struct jumper *j, size_t id)
+{
+	return id == GRAPH_NO_ID ? 0 : graph_grid_cost(j->ctx->g, id);
+}
+
+// Whether a vertical run through a cell costing here has to turn towards a
+// side cell costing beside, where the cell behind that one costs behind
+static bool must_turn(double beside, double behind, double here)
+{
+	return beside > 0 && (behind <= 0 || behind > here);
+}
+
+// As must_turn, for a run that came into id going dir
+static bool is_forced(const struct jumper *j, size_t id, unsigned dir,
+		unsigned side)
+{
+	size_t beside = step(j, id, side);
+	return must_turn(cost(j, beside), cost(j, step(j, beside, opposite(dir))),
+			cost(j, id));
+}
+
+// Walks from id in dir to the next node worth queueing: end, a forced turn,
+// a change in cost, or, going horizontally, a cell whose vertical runs find
+// one of those.  Returns GRAPH_NO_ID if the run hits a wall first, and
+// otherwise sets *walked to the cost of the run.
+static size_t jump(const struct jumper *j, size_t id, unsigned dir,
+		double *walked)
+{
+	bool vertical = is_vertical(dir);
+	double here = cost(j, id);
+	// Going vertically, the costs either side of the last cell, each of
+	// which is behind the cell beside the next one
+	double right = vertical ? cost(j, step(j, id, JUMP_RIGHT)) : 0;
+	double left = vertical ? cost(j, step(j, id, JUMP_LEFT)) : 0;
+
+	double total = 0;
+	size_t curr = id;
+	while (true) {
+		size_t next = step(j, curr, dir);
+		double there = cost(j, next);
+		if (there <= 0) {
+			return GRAPH_NO_ID;
+		}
+
+		total += there;
+		curr = next;
+		if (curr == j->end || there < here || there > here) {
+			break;
+		}
+
+		if (vertical) {
+			double next_right = cost(j, step(j, curr, JUMP_RIGHT));
+			double next_left = cost(j, step(j, curr, JUMP_LEFT));
+			if (must_turn(next_right, right, there)
+					|| must_turn(next_left, left, there)) {
+				break;
+			}
+			right = next_right;
+			left = next_left;
+		} else {
+			double ignored;
+			if (jump(j, curr, JUMP_DOWN, &ignored) != GRAPH_NO_ID
+					|| jump(j, curr, JUMP_UP, &ignored) != GRAPH_NO_ID) {
+				break;
+			}
+		}
+		here = there;
+	}
+
+	*walked = total;
+	return curr;
+}
+
+static void relax_jump(struct jumper *j, size_t id, double weight,
+		unsigned dir)
+{
+	dijkstra_ctx *ctx = j->ctx;
+
+	stats.relaxed++;
+	double distance = ctx->curr_distance + weight;
+	double best = distance_to(ctx, id);
+	if (distance < best) {
+		reach(ctx, id, distance, ctx->curr);
+		j->arrivals[id] = dir;
+	} else if (distance > best || j->arrivals[id] & dir) {
+		return;
+	} else {
+		// Ties can come in after id was expanded, so it goes round again
+		j->arrivals[id] |= dir;
+	}
+
+	double priority = distance + estimate(ctx, graph_node_data(ctx->g, id));
+	queue(ctx, id_as_item(id), priority);
+}
+
+// Runs in every direction a canonical path may carry on in from curr
+static void expand_jumps(struct jumper *j)
+{
+	size_t curr = j->ctx->curr;
+	unsigned arrivals = j->arrivals[curr];
+
+	unsigned dirs = 0;
+	for (unsigned dir = JUMP_DOWN; dir <= JUMP_LEFT; dir <<= 1) {
+		if (!(arrivals & dir)) {
+			continue;
+		}
+
+		dirs |= dir;
+		if (!is_vertical(dir)) {
+			dirs |= JUMP_DOWN | JUMP_UP;
+		} else {
+			if (is_forced(j, curr, dir, JUMP_RIGHT)) {
+				dirs |= JUMP_RIGHT;
+			}
+			if (is_forced(j, curr, dir, JUMP_LEFT)) {
+				dirs |= JUMP_LEFT;
+			}
+		}
 	}
-	map_destroy(distance_from_origin);
-	map_destroy(previous);
-	pqueue_destroy(to_process);
+
+	for (unsigned dir = JUMP_DOWN; dir <= JUMP_LEFT; dir <<= 1) {
+		double walked;
+		size_t found;
+		if (dirs & dir
+				&& (found = jump(j, curr, dir, &walked)) != GRAPH_NO_ID) {
+			relax_jump(j, found, walked, dir);
+		}
+	}
+}
+
+// As trace, but fills in the cells along each run between jump points
+static bool trace_jumps(const struct jumper *j, size_t start, list *results)
+{
+	const dijkstra_ctx *ctx = j->ctx;
+	if (previous_hop(ctx, j->end) == GRAPH_NO_ID) {
+		return true;
+	}
+
+	size_t cells = 0;
+	for (size_t curr = j->end; curr != start; ) {
+		size_t from = previous_hop(ctx, curr);
+		size_t stride = curr / j->width == from / j->width ? 1 : j->width;
+		cells += (curr > from ? curr - from : from - curr) / stride;
+		curr = from;
+	}
+	list_reserve(results, cells);
+
+	for (size_t curr = j->end; curr != start; ) {
+		size_t from = previous_hop(ctx, curr);
+		size_t stride = curr / j->width == from / j->width ? 1 : j->width;
+		for (; curr != from; curr = curr > from ? curr - stride
+				: curr + stride) {
+			list_prepend(results, graph_node_data(ctx->g, curr));
+		}
+	}
+
+	return list_size(results) == cells;
+}
+
+list *jps_path_ids(const graph *g, size_t start, size_t end,
+		path_heuristic_func h, void *arg)
+{
+	size_t width = graph_grid_width(g);
+	if (!width) {
+		return astar_path_ids(g, start, end, h, arg);
+	}
+
+	struct jumper j = {
+		.ctx = dijkstra_ctx_create(g),
+		.width = width,
+		.end = end,
+		.arrivals = calloc(graph_id_bound(g), 1)
+	};
+	// Results are borrowed from the graph
+	list *results = list_create(NULL);
+	if (!j.ctx || !j.arrivals || !results || start >= j.ctx->count
+			|| end >= j.ctx->count) {
+		dijkstra_ctx_destroy(j.ctx);
+		free(j.arrivals);
+		return results;
+	}
+
+	dijkstra_ctx *ctx = j.ctx;
+	dijkstra_ctx_set_heuristic(ctx, h, arg);
+	ctx->goal = graph_node_data(g, end);
+	begin(ctx, start);
+	j.arrivals[start] = JUMP_DOWN | JUMP_RIGHT | JUMP_UP | JUMP_LEFT;
+
+	while (!ctx->failed && !pqueue_is_empty(ctx->to_process)) {
+		ctx->curr = item_as_id(dequeue(ctx));
+		ctx->curr_distance = distance_to(ctx, ctx->curr);
+		if (ctx->curr == end) {
+			break;
+		}
+
+		stats.expanded++;
+		expand_jumps(&j);
+	}
+	if (ctx->failed || !trace_jumps(&j, start, results)) {
+		list_destroy(results);
+		results = NULL;
+	}
+
+	dijkstra_ctx_destroy(ctx);
+	free(j.arrivals);
 
 	return results;
 }
+
+list *jps_path(const graph *g, const void *start, const void *end,
+		path_heuristic_func h, void *arg)
+{
+	size_t start_id = graph_node_id(g, start);
+	size_t end_id = graph_node_id(g, end);
+	if (start_id == GRAPH_NO_ID || end_id == GRAPH_NO_ID) {
+		return astar_path(g, start, end, h, arg);
+	}
+
+	return jps_path_ids(g, start_id, end_id, h, arg);
+}
+
+// Delta-stepping settles nodes a bucket of distances delta wide at a time,
+// with every thread relaxing its share of the bucket at once.  Edges no
+// heavier than delta can land back in the bucket being settled, so those
+// go round until it stops changing; heavier ones are relaxed once after.
+struct id_list {
+	size_t *ids;
+	size_t size;
+	size_t capacity;
+};
+
+struct stepper {
+	const graph *g;
+	double delta;
+	size_t end;
+
+	// Distances are lowered from any thread; the stamps mark the round a
+	// node was last queued in, and the bucket it was last settled in, so
+	// that each goes in once however many threads reach it
+	_Atomic double *distance;
+	_Atomic size_t *queued;
+	_Atomic size_t *settled;
+	atomic_bool failed;
+
+	pthread_mutex_t gate;
+	pthread_barrier_t barrier;
+
+	// Only changed by the first worker, between the two barriers
+	struct id_list frontier;
+	size_t round;
+	size_t current;
+	bool heavy;
+	bool done;
+
+	// Nodes waiting in later buckets, as a ring from the current one
+	struct id_list *ring;
+	size_t ring_count;
+	size_t waiting;
+
+	// Nodes passed over in a bucket, having since moved to an earlier one,
+	// and the most nodes any one phase had to settle
+	size_t stale;
+	size_t peak_frontier;
+
+	struct step_worker *workers;
+	size_t worker_count;
+};
+
+struct step_worker {
+	struct stepper *s;
+	size_t index;
+	double from_distance;
+
+	// Counted apart, and added up for the caller once the search is over:
+	// nodes taken from the frontier, the ones of those settled for the
+	// first time, and edges relaxed
+	size_t dequeued;
+	size_t expanded;
+	size_t relaxed;
+
+	// Nodes this worker lowered into the current bucket or a later one,
+	// and the ones it settled in the current bucket
+	struct id_list next;
+	struct id_list later;
+	struct id_list done;
+};
+
+static bool id_list_push(struct id_list *l, size_t id)
+{
+	if (l->size == l->capacity) {
+		size_t capacity = l->capacity ? 2 * l->capacity : 64;
+		size_t *bigger = realloc(l->ids, capacity * sizeof(*bigger));
+		if (!bigger) {
+			return false;
+		}
+
+		l->ids = bigger;
+		l->capacity = capacity;
+	}
+
+	l->ids[l->size++] = id;
+	return true;
+}
+
+static size_t bucket_of(const struct stepper *s, double distance)
+{
+	return (size_t)(distance / s->delta);
+}
+
+static void relax_step(size_t neighbor, double weight, void *arg)
+{
+	struct step_worker *w = arg;
+	struct stepper *s = w->s;
+	if (s->heavy != (weight > s->delta)) {
+		return;
+	}
+	w->relaxed++;
+
+	double distance = w->from_distance + weight;
+	double old = atomic_load_explicit(&s->distance[neighbor],
+			memory_order_relaxed);
+	while (distance < old) {
+		if (!atomic_compare_exchange_weak_explicit(&s->distance[neighbor],
+					&old, distance, memory_order_relaxed,
+					memory_order_relaxed)) {
+			continue;
+		}
+
+		bool pushed;
+		if (bucket_of(s, distance) != s->current) {
+			pushed = id_list_push(&w->later, neighbor);
+		} else if (atomic_exchange(&s->queued[neighbor], s->round + 1)
+				!= s->round + 1) {
+			pushed = id_list_push(&w->next, neighbor);
+		} else {
+			pushed = true;
+		}
+		if (!pushed) {
+			atomic_store(&s->failed, true);
+		}
+		break;
+	}
+}
+
+static void relax_from(struct step_worker *w, size_t id)
+{
+	w->from_distance = atomic_load_explicit(&w->s->distance[id],
+			memory_order_relaxed);
+	graph_iterate_neighbor_ids(w->s->g, id, relax_step, w);
+}
+
+// Queues id to be settled in the bucket its distance now falls in
+static bool file_later(struct stepper *s, size_t id)
+{
+	size_t bucket = bucket_of(s, atomic_load(&s->distance[id]));
+	if (bucket == s->current) {
+		// Case: lowered again since, into the bucket being settled, so
+		// whoever did that has already queued it
+		return true;
+	} else if (bucket - s->current >= s->ring_count) {
+		size_t count = 2 * s->ring_count;
+		while (count <= bucket - s->current) {
+			count *= 2;
+		}
+
+		struct id_list *bigger = calloc(count, sizeof(*bigger));
+		if (!bigger) {
+			return false;
+		}
+
+		for (size_t k=s->current; k < s->current + s->ring_count; ++k) {
+			bigger[k & (count - 1)] = s->ring[k & (s->ring_count - 1)];
+		}
+
+		free(s->ring);
+		s->ring = bigger;
+		s->ring_count = count;
+	}
+
+	s->waiting++;
+	return id_list_push(&s->ring[bucket & (s->ring_count - 1)], id);
+}
+
+// Sets up the next phase once every worker has finished the last one
+static void plan_step(struct stepper *s)
+{
+	bool filed = true;
+	for (size_t n=0; n < s->worker_count; ++n) {
+		struct id_list *later = &s->workers[n].later;
+		for (size_t k=0; k < later->size; ++k) {
+			filed = file_later(s, later->ids[k]) && filed;
+		}
+		later->size = 0;
+	}
+	if (!filed || atomic_load(&s->failed)) {
+		s->done = true;
+		return;
+	}
+
+	s->round++;
+	s->frontier.size = 0;
+	if (!s->heavy) {
+		// Case: light edges led back into this bucket, so go round again
+		for (size_t n=0; n < s->worker_count; ++n) {
+			struct id_list *next = &s->workers[n].next;
+			for (size_t k=0; k < next->size; ++k) {
+				filed = id_list_push(&s->frontier, next->ids[k]) && filed;
+			}
+			next->size = 0;
+		}
+
+		if (s->frontier.size > s->peak_frontier) {
+			s->peak_frontier = s->frontier.size;
+		}
+		s->heavy = s->frontier.size == 0;
+		s->done = !filed;
+		return;
+	}
+
+	// Case: this bucket is settled, so open the next one with anything in
+	s->heavy = false;
+	while (s->frontier.size == 0 && s->waiting) {
+		s->current++;
+		// Case: end was settled in a bucket already done with
+		if (atomic_load(&s->distance[s->end])
+				< (double)s->current * s->delta) {
+			break;
+		}
+
+		struct id_list *bucket = &s->ring[s->current & (s->ring_count - 1)];
+		for (size_t k=0; k < bucket->size; ++k) {
+			size_t id = bucket->ids[k];
+			if (bucket_of(s, atomic_load(&s->distance[id])) != s->current) {
+				s->stale++;
+			} else if (atomic_exchange(&s->queued[id], s->round)
+					!= s->round) {
+				filed = id_list_push(&s->frontier, id) && filed;
+			}
+		}
+		s->waiting -= bucket->size;
+		bucket->size = 0;
+	}
+
+	if (s->frontier.size > s->peak_frontier) {
+		s->peak_frontier = s->frontier.size;
+	}
+	s->done = !filed || s->frontier.size == 0;
+}
+
+static void *run_steps(void *arg)
+{
+	struct step_worker *w = arg;
+	struct stepper *s = w->s;
+
+	pthread_mutex_lock(&s->gate);
+	bool stopped = s->done;
+	pthread_mutex_unlock(&s->gate);
+
+	while (!stopped) {
+		pthread_barrier_wait(&s->barrier);
+		if (s->done) {
+			break;
+		}
+
+		if (s->heavy) {
+			for (size_t k=0; k < w->done.size; ++k) {
+				relax_from(w, w->done.ids[k]);
+			}
+			w->done.size = 0;
+		} else {
+			// Each worker takes every worker_count-th node in the frontier
+			for (size_t k=w->index; k < s->frontier.size;
+					k += s->worker_count) {
+				size_t id = s->frontier.ids[k];
+				w->dequeued++;
+				// Case: not yet settled in this bucket; going round again
+				// only relaxes its light edges once more
+				if (atomic_exchange(&s->settled[id], s->current + 1)
+						!= s->current + 1) {
+					w->expanded++;
+					if (!id_list_push(&w->done, id)) {
+						atomic_store(&s->failed, true);
+					}
+				}
+				relax_from(w, id);
+			}
+		}
+
+		pthread_barrier_wait(&s->barrier);
+		if (w->index == 0) {
+			plan_step(s);
+		}
+	}
+
+	return NULL;
+}
+
+// Fills results with a cheapest path to end, found by going back from it
+// along edges that account for the whole of the difference in distance
+struct tight_edge {
+	const struct stepper *s;
+	double distance;
+	size_t from;
+};
+
+static void find_tight_edge(size_t neighbor, double weight, void *arg)
+{
+	struct tight_edge *t = arg;
+	double distance = atomic_load(&t->s->distance[neighbor]) + weight;
+	if (t->from == GRAPH_NO_ID
+			&& !(distance < t->distance) && !(distance > t->distance)) {
+		t->from = neighbor;
+	}
+}
+
+static bool trace_steps(const struct stepper *s, size_t start, list *results)
+{
+	if (isinf(atomic_load(&s->distance[s->end]))) {
+		return true;
+	}
+
+	// Weights are positive, so every step back gets closer to start
+	size_t hops = 0;
+	for (size_t curr = s->end; curr != start && curr != GRAPH_NO_ID; ++hops) {
+		list_prepend(results, graph_node_data(s->g, curr));
+
+		struct tight_edge t = { s, atomic_load(&s->distance[curr]),
+			GRAPH_NO_ID };
+		graph_iterate_in_neighbor_ids(s->g, curr, find_tight_edge, &t);
+		curr = t.from;
+	}
+
+	return list_size(results) == hops;
+}
+
+static void stepper_destroy(struct stepper *s)
+{
+	for (size_t n=0; n < s->worker_count; ++n) {
+		free(s->workers[n].next.ids);
+		free(s->workers[n].later.ids);
+		free(s->workers[n].done.ids);
+	}
+	for (size_t k=0; k < s->ring_count; ++k) {
+		free(s->ring[k].ids);
+	}
+
+	free(s->workers);
+	free(s->ring);
+	free(s->frontier.ids);
+	free(s->distance);
+	free(s->queued);
+	free(s->settled);
+}
+
+list *delta_stepping_path_ids(const graph *g, size_t start, size_t end,
+		double delta, size_t threads)
+{
+	size_t count = graph_id_bound(g);
+	if (!count || !(delta > 0) || threads < 1) {
+		return NULL;
+	}
+
+	struct stepper s = {
+		.g = g,
+		.delta = delta,
+		.end = end,
+		.distance = malloc(count * sizeof(*s.distance)),
+		.queued = calloc(count, sizeof(*s.queued)),
+		.settled = calloc(count, sizeof(*s.settled)),
+		.ring = calloc(1, sizeof(*s.ring)),
+		.ring_count = 1,
+		.workers = calloc(threads, sizeof(*s.workers)),
+		.worker_count = threads,
+		.gate = PTHREAD_MUTEX_INITIALIZER
+	};
+	atomic_init(&s.failed, false);
+	// Results are borrowed from the graph
+	list *results = list_create(NULL);
+	if (!s.distance || !s.queued || !s.settled || !s.ring || !s.workers
+			|| !results || !id_list_push(&s.frontier, start)) {
+		stepper_destroy(&s);
+		list_destroy(results);
+		return NULL;
+	} else if (start >= count || end >= count) {
+		stepper_destroy(&s);
+		return results;
+	}
+
+	for (size_t id=0; id < count; ++id) {
+		atomic_init(&s.distance[id], INFINITY);
+	}
+	atomic_init(&s.distance[start], 0);
+
+	pthread_t *ids = malloc(threads * sizeof(*ids));
+	if (!ids) {
+		stepper_destroy(&s);
+		list_destroy(results);
+		return NULL;
+	}
+
+	// Workers wait at the gate until it is known how many of them started,
+	// which is how many the barrier has to hold up
+	pthread_mutex_lock(&s.gate);
+	size_t started = 1;
+	for (size_t n=0; n < threads; ++n) {
+		s.workers[n].s = &s;
+		s.workers[n].index = n;
+	}
+	while (started < threads && !pthread_create(&ids[started], NULL,
+				run_steps, &s.workers[started])) {
+		started++;
+	}
+	s.worker_count = started;
+	bool ready = !pthread_barrier_init(&s.barrier, NULL, started);
+	if (!ready) {
+		// Case: no barrier to run with, so send any workers straight home
+		s.done = true;
+		atomic_store(&s.failed, true);
+	}
+	pthread_mutex_unlock(&s.gate);
+
+	if (ready) {
+		run_steps(&s.workers[0]);
+	}
+	for (size_t n=1; n < started; ++n) {
+		pthread_join(ids[n], NULL);
+	}
+	for (size_t n=0; n < started; ++n) {
+		stats.dequeued += s.workers[n].dequeued;
+		stats.expanded += s.workers[n].expanded;
+		stats.relaxed += s.workers[n].relaxed;
+	}
+	stats.stale += s.stale;
+	if (s.peak_frontier > stats.peak_queued) {
+		stats.peak_queued = s.peak_frontier;
+	}
+	if (ready) {
+		pthread_barrier_destroy(&s.barrier);
+	}
+	free(ids);
+
+	if (atomic_load(&s.failed) || !trace_steps(&s, start, results)) {
+		list_destroy(results);
+		results = NULL;
+	}
+	stepper_destroy(&s);
+
+	return results;
+}
+
+list *delta_stepping_path(const graph *g, const void *start, const void *end,
+		double delta, size_t threads)
+{
+	size_t start_id = graph_node_id(g, start);
+	size_t end_id = graph_node_id(g, end);
+	if (start_id == GRAPH_NO_ID || end_id == GRAPH_NO_ID) {
+		// Without ids there is no shared table of distances to work in
+		return dijkstra_path(g, start, end);
+	}
+
+	return delta_stepping_path_ids(g, start_id, end_id, delta, threads);
+}
+
+struct path_tree_ {
+	// Holds the finished search, which nothing runs again
+	dijkstra_ctx *ctx;
+	size_t start;
+};
+
+path_tree *path_tree_create_ids(const graph *g, size_t start)
+{
+	if (start >= graph_id_bound(g)) {
+		return NULL;
+	}
+
+	path_tree *tree = malloc(sizeof(*tree));
+	if (!tree) {
+		return NULL;
+	}
+
+	tree->ctx = dijkstra_ctx_create(g);
+	if (!tree->ctx) {
+		free(tree);
+		return NULL;
+	}
+	tree->start = start;
+
+	settle(tree->ctx, start, GRAPH_NO_ID);
+	if (tree->ctx->failed) {
+		path_tree_destroy(tree);
+		return NULL;
+	}
+
+	return tree;
+}
+
+path_tree *path_tree_create(const graph *g, const void *start)
+{
+	return path_tree_create_ids(g, graph_node_id(g, start));
+}
+
+list *path_tree_path_to_id(const path_tree *tree, size_t end)
+{
+	if (!tree) {
+		return NULL;
+	}
+
+	// Results are borrowed from the graph
+	list *results = list_create(NULL);
+	if (results && end < tree->ctx->count
+			&& !trace(tree->ctx, tree->start, end, results)) {
+		list_destroy(results);
+		return NULL;
+	}
+
+	return results;
+}
+
+list *path_tree_path_to(const path_tree *tree, const void *end)
+{
+	if (!tree) {
+		return NULL;
+	}
+
+	return path_tree_path_to_id(tree, graph_node_id(tree->ctx->g, end));
+}
+
+double path_tree_distance_to_id(const path_tree *tree, size_t end)
+{
+	if (!tree || end >= tree->ctx->count) {
+		return INFINITY;
+	}
+
+	return distance_to(tree->ctx, end);
+}
+
+double path_tree_distance_to(const path_tree *tree, const void *end)
+{
+	if (!tree) {
+		return INFINITY;
+	}
+
+	return path_tree_distance_to_id(tree, graph_node_id(tree->ctx->g, end));
+}
+
+void path_tree_destroy(path_tree *tree)
+{
+	if (!tree) {
+		return;
+	}
+
+	dijkstra_ctx_destroy(tree->ctx);
+	free(tree);
+}
+
+void path_get_stats(struct path_stats *out)
+{
+	if (out) {
+		*out = stats;
+	}
+}
+
+void path_reset_stats(void)
+{
+	stats = (struct path_stats) { 0 };
+}
@@ -4,6 +4,125 @@
 #include "list.h"
 #include "graph.h"
 
+// Returns the nodes after start up to and including end along a cheapest
+// path, an empty list if end cannot be reached, or NULL if memory runs
+// out.  Graphs with node ids (see graph_id_bound) are searched through
+// dijkstra_path_ids.
 list *dijkstra_path(const graph *g, const void *start, const void *end);
 
+// As dijkstra_path, but start and end are node ids, and the distances and
+// previous hops live in flat arrays indexed by id
+list *dijkstra_path_ids(const graph *g, size_t start, size_t end);
+
+// Estimates the cost of getting from one node to another.  A* only
+// promises a cheapest path if this never overestimates, and never drops
+// by more than the weight of an edge along it.
+typedef double (*path_heuristic_func)(const void *from, const void *to,
+		void *arg);
+
+// As dijkstra_path and dijkstra_path_ids, but heads for end first, using
+// h (called with arg) to rank nodes by their distance plus their estimate
+list *astar_path(const graph *g, const void *start, const void *end,
+		path_heuristic_func h, void *arg);
+list *astar_path_ids(const graph *g, size_t start, size_t end,
+		path_heuristic_func h, void *arg);
+
+// As dijkstra_path and dijkstra_path_ids, but searches out from both ends
+// at once, following edges backwards from end, until the two sides meet.
+// Graphs without ids fall back to dijkstra_path.
+list *bidirectional_path(const graph *g, const void *start, const void *end);
+list *bidirectional_path_ids(const graph *g, size_t start, size_t end);
+
+// As astar_path and astar_path_ids, but on grid graphs (see
+// graph_grid_width) runs straight across stretches of equal cost without
+// queueing every cell, stopping only where a path could have to turn or
+// the cost changes.  Any other graph falls back to A*.
+list *jps_path(const graph *g, const void *start, const void *end,
+		path_heuristic_func h, void *arg);
+list *jps_path_ids(const graph *g, size_t start, size_t end,
+		path_heuristic_func h, void *arg);
+
+// As dijkstra_path and dijkstra_path_ids, but settles nodes in buckets of
+// distances delta wide, with threads workers relaxing each bucket at once.
+// Edges no heavier than delta are relaxed until the bucket stops changing,
+// heavier ones once it has.  Weights must be positive.  Returns NULL if
+// threads is 0, delta is not positive, or memory runs out; graphs without
+// ids fall back to dijkstra_path.
+list *delta_stepping_path(const graph *g, const void *start, const void *end,
+		double delta, size_t threads);
+list *delta_stepping_path_ids(const graph *g, size_t start, size_t end,
+		double delta, size_t threads);
+
+typedef struct dijkstra_ctx_ dijkstra_ctx;
+
+// A context owns the queue and tables that searches over g work in, so
+// nothing is shared between contexts: each thread can run its own queries
+// against the same graph, as long as nobody changes the graph meanwhile.
+// Reusing a context for several queries also saves setting it up again.
+dijkstra_ctx *dijkstra_ctx_create(const graph *g);
+
+// As dijkstra_ctx_create, but on grid graphs (see graph_grid_width) keeps
+// each cell's distance in 4 bytes, as a count of half steps, and its
+// previous hop as one of the 4 neighbors in 2 bits, where the usual tables
+// take 16 bytes a cell; searches run somewhat slower for it.  A distance
+// that is not a whole number of half steps, or too long to count, moves
+// the context over to the usual tables.  Any other graph gets the usual
+// context.
+dijkstra_ctx *dijkstra_ctx_create_compact(const graph *g);
+
+// Same results as dijkstra_path and dijkstra_path_ids
+list *dijkstra_ctx_path(dijkstra_ctx *ctx, const void *start, const void *end);
+list *dijkstra_ctx_path_ids(dijkstra_ctx *ctx, size_t start, size_t end);
+
+// Makes later searches with ctx run as A* with h; pass h=NULL to go back
+// to plain Dijkstra
+void dijkstra_ctx_set_heuristic(dijkstra_ctx *ctx, path_heuristic_func h,
+		void *arg);
+
+void dijkstra_ctx_destroy(dijkstra_ctx *ctx);
+
+typedef struct path_tree_ path_tree;
+
+// Searches out from start to every node it can reach, once, and keeps the
+// distances and previous hops as a tree of cheapest paths to read any
+// number of ends off.  Only graphs with node ids (see graph_id_bound) can
+// be searched this way; returns NULL for any other.
+path_tree *path_tree_create(const graph *g, const void *start);
+path_tree *path_tree_create_ids(const graph *g, size_t start);
+
+// Same results as dijkstra_path from the tree's start, in time along the
+// path alone.  A finished tree is only ever read, so any number of
+// threads can query it at once.
+list *path_tree_path_to(const path_tree *tree, const void *end);
+list *path_tree_path_to_id(const path_tree *tree, size_t end);
+
+// Cost of the cheapest path from the tree's start to end, or INFINITY if
+// there is none
+double path_tree_distance_to(const path_tree *tree, const void *end);
+double path_tree_distance_to_id(const path_tree *tree, size_t end);
+
+void path_tree_destroy(path_tree *tree);
+
+// What the searches run on a thread have done
+struct path_stats {
+	// Nodes taken off a queue, and how many of those had their edges
+	// relaxed; the end of a search comes off without being expanded
+	size_t dequeued;
+	size_t expanded;
+	size_t relaxed;
+
+	// Places left in a queue by nodes that moved to an earlier one, and
+	// passed over on the way to the next node
+	size_t stale;
+
+	// The most nodes any one search had queued at once
+	size_t peak_queued;
+};
+
+// Fills stats in with what the searches run on the calling thread have
+// done since it last called path_reset_stats.  Delta-stepping counts what
+// its workers did for the thread that called it.
+void path_get_stats(struct path_stats *stats);
+void path_reset_stats(void);
+
 #endif
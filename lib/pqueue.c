@@ -1,20 +1,58 @@
 #include "pqueue.h"
 
 #include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 struct node {
 	double priority;
 	void *value;
+
+	// Where value's slot is in the index, so that moving the node only
+	// has to tell the slot, without looking it up
+	size_t slot;
+};
+
+// Items whose priorities share a multiple of BUCKET_WIDTH, oldest at head;
+// items moved out by a decrease leave a NULL value behind
+struct bucket {
+	struct node *items;
+	size_t head;
+	size_t size;
+	size_t capacity;
+};
+
+// Where a queued item is: its heap index, or its place in its bucket
+struct slot {
+	const void *value;
+	double priority;
+	size_t pos;
 };
 
 struct pq_ {
-	struct node **data;
+	struct node *data;
 	size_t size;
 	size_t capacity;
 	// Is left more urgent than right
 	bool (*is_more_urgent_than)(double left, double right);
+
+	// Open-addressed from each item to its slot, so that finding an item
+	// never means searching the queue
+	struct slot *index;
+	size_t index_capacity;
+
+	// Only set while a BUCKET_PQUEUE is still using buckets; the bucket
+	// for priority p is the one for key p / BUCKET_WIDTH, in a ring of
+	// bucket_count that covers keys from base onwards
+	struct bucket *buckets;
+	size_t bucket_count;
+	size_t base;
+
+	// Kept as the queue is used, for pqueue_peak_size and
+	// pqueue_stale_count
+	size_t peak_size;
+	size_t stale_count;
 };
 
 static bool min_heap_cmp(double left, double right)
@@ -31,7 +69,28 @@ static bool max_heap_cmp(double left, double right)
 
 
 // Seems like a good pick for the default?
-enum { DEFAULT_CAPACITY=16 };
+// Ring and index sizes are powers of two so a key's place is just its low
+// bits; keys further than MAX_BUCKET_SPAN past base send the queue to the
+// heap, and the index is kept at most half full
+enum {
+	DEFAULT_CAPACITY=16, DEFAULT_BUCKETS=16, MAX_BUCKET_SPAN=1 << 20,
+	DEFAULT_INDEX=32
+};
+
+// Maze cell weights are all multiples of a half
+static const double BUCKET_WIDTH = 0.5;
+
+static struct slot *index_find(const pqueue *pq, const void *value);
+static bool index_insert(pqueue *pq, const void *value, double priority,
+		size_t pos);
+static void index_remove(pqueue *pq, struct slot *s);
+static struct node *slot_node(pqueue *pq, const struct slot *s);
+static bool heap_insert(pqueue *pq, double priority, void *data);
+static void heap_decrease(pqueue *pq, struct slot *s, double priority);
+static bool bucket_enqueue(pqueue *pq, double priority, void *data);
+static void *bucket_dequeue(pqueue *pq, double *priority);
+static bool buckets_to_heap(pqueue *pq);
+static void buckets_destroy(struct bucket *buckets, size_t count);
 
 pqueue *pqueue_create(enum pqueue_type type)
 {
@@ -42,14 +101,33 @@ pqueue *pqueue_create(enum pqueue_type type)
 
 	pq->size = 0;
 	pq->capacity = DEFAULT_CAPACITY;
-	if (type == MIN_PQUEUE) {
-		pq->is_more_urgent_than = min_heap_cmp;
-	} else {
+	pq->peak_size = 0;
+	pq->stale_count = 0;
+	if (type == MAX_PQUEUE) {
 		pq->is_more_urgent_than = max_heap_cmp;
+	} else {
+		pq->is_more_urgent_than = min_heap_cmp;
+	}
+
+	pq->buckets = NULL;
+	pq->bucket_count = 0;
+	pq->base = 0;
+	if (type == BUCKET_PQUEUE) {
+		pq->buckets = calloc(DEFAULT_BUCKETS, sizeof(*pq->buckets));
+		if (!pq->buckets) {
+			free(pq);
+			return NULL;
+		}
+		pq->bucket_count = DEFAULT_BUCKETS;
 	}
 
+	pq->index_capacity = DEFAULT_INDEX;
+	pq->index = calloc(pq->index_capacity, sizeof(*pq->index));
 	pq->data = malloc(pq->capacity * sizeof(*pq->data));
-	if (!pq->data) {
+	if (!pq->data || !pq->index) {
+		free(pq->data);
+		free(pq->index);
+		free(pq->buckets);
 		free(pq);
 		return NULL;
 	}
@@ -81,87 +159,99 @@ static size_t right(size_t idx)
 	return 2*idx + 2;
 }
 
-static void bubble_up(pqueue *pq)
+// Puts node at heap index idx, and tells the index it went there
+static void place(pqueue *pq, size_t idx, struct node node)
 {
-	size_t idx = pq->size - 1;
+	pq->data[idx] = node;
+	pq->index[node.slot].pos = idx;
+}
 
+// Sifting moves a hole rather than swapping, so each level moves one node
+static void bubble_up(pqueue *pq, size_t idx)
+{
+	struct node moving = pq->data[idx];
 	while (idx > 0) {
 		size_t parent_idx = parent(idx);
-
-		if (pq->is_more_urgent_than(pq->data[idx]->priority,
-					pq->data[parent_idx]->priority)) {
-			// Swap
-			struct node *tmp = pq->data[idx];
-			pq->data[idx] = pq->data[parent_idx];
-			pq->data[parent_idx] = tmp;
-		} else {
-			return;
+		if (!pq->is_more_urgent_than(moving.priority,
+					pq->data[parent_idx].priority)) {
+			break;
 		}
 
+		place(pq, idx, pq->data[parent_idx]);
 		idx = parent_idx;
 	}
+	place(pq, idx, moving);
 }
 
 bool pqueue_enqueue(pqueue *pq, double priority, void *data)
 {
-	if (!pq || !data) {
+	if (!pq || !data || index_find(pq, data)) {
 		return false;
 	}
 
-	struct node *new = malloc(sizeof(*new));
-	if (!new) {
-		return false;
+	if (pq->buckets) {
+		if (bucket_enqueue(pq, priority, data)) {
+			return true;
+		}
+
+		// Case: priority does not fit the buckets, so fall back on the heap
+		if (!buckets_to_heap(pq)) {
+			return false;
+		}
 	}
 
-	new->priority = priority;
-	new->value = data;
+	return heap_insert(pq, priority, data);
+}
+
+static bool heap_insert(pqueue *pq, double priority, void *data)
+{
+	if (pq->size == pq->capacity) {
+		struct node *bigger = realloc(pq->data,
+				2 * pq->capacity * sizeof(*pq->data));
+		if (!bigger) {
+			return false;
+		}
 
-	// TODO resize if size == capacity
+		pq->data = bigger;
+		pq->capacity *= 2;
+	}
 
-	pq->data[pq->size] = new;
+	// The node goes in first, for the index to say which slot it has
+	pq->data[pq->size].priority = priority;
+	pq->data[pq->size].value = data;
+	if (!index_insert(pq, data, priority, pq->size)) {
+		return false;
+	}
 	pq->size++;
+	if (pq->size > pq->peak_size) {
+		pq->peak_size = pq->size;
+	}
 
-	bubble_up(pq);
+	bubble_up(pq, pq->size - 1);
 
 	return true;
 }
 
-static void bubble_down(pqueue *pq)
+static void bubble_down(pqueue *pq, size_t idx)
 {
-	size_t idx = 0;
-	while (idx < pq->size) {
-		size_t left_idx = left(idx);
-		size_t right_idx = right(idx);
-
-		// TODO refactor to simplify
-		if (left_idx >= pq->size) {
-			return;
-		} else if (right_idx >= pq->size) {
-			if (pq->is_more_urgent_than(pq->data[left_idx]->priority,
-						pq->data[idx]->priority)) {
-				struct node *tmp = pq->data[idx];
-				pq->data[idx] = pq->data[left_idx];
-				pq->data[left_idx] = tmp;
-				return;
-			}
-		}
-
-		size_t to_swap_idx = left_idx;
-		if (pq->is_more_urgent_than(pq->data[right_idx]->priority,
-					pq->data[left_idx]->priority)) {
-			to_swap_idx = right_idx;
+	struct node moving = pq->data[idx];
+	while (left(idx) < pq->size) {
+		size_t to_swap_idx = left(idx);
+		if (right(idx) < pq->size
+				&& pq->is_more_urgent_than(pq->data[right(idx)].priority,
+					pq->data[to_swap_idx].priority)) {
+			to_swap_idx = right(idx);
 		}
 
-		if (pq->is_more_urgent_than(pq->data[idx]->priority,
-					pq->data[to_swap_idx]->priority)) {
-			return;
+		if (!pq->is_more_urgent_than(pq->data[to_swap_idx].priority,
+					moving.priority)) {
+			break;
 		}
-		struct node *tmp = pq->data[idx];
-		pq->data[idx] = pq->data[to_swap_idx];
-		pq->data[to_swap_idx] = tmp;
 
+		place(pq, idx, pq->data[to_swap_idx]);
 		idx = to_swap_idx;
 	}
+	place(pq, idx, moving);
 }
 
 void *pqueue_dequeue(pqueue *pq, double *priority)
@@ -170,35 +260,74 @@ void *pqueue_dequeue(pqueue *pq, double *priority)
 		return NULL;
 	}
 
-	void *result = pq->data[0]->value;
+	if (pq->buckets) {
+		return bucket_dequeue(pq, priority);
+	}
+
+	void *result = pq->data[0].value;
 
 	if (priority) {
-		*priority = pq->data[0]->priority;
+		*priority = pq->data[0].priority;
 	}
 
-	free(pq->data[0]);
-	pq->data[0] = pq->data[pq->size - 1];
+	index_remove(pq, &pq->index[pq->data[0].slot]);
 	pq->size--;
-
-	bubble_down(pq);
+	if (pq->size > 0) {
+		pq->data[0] = pq->data[pq->size];
+		bubble_down(pq, 0);
+	}
 
 	return result;
 }
 
-bool pqueue_contains(const pqueue *pq, const void *data)
+bool pqueue_decrease_priority(pqueue *pq, const void *data, double priority)
 {
 	if (!pq || !data) {
 		return false;
 	}
 
-	for (size_t n=0; n < pq->size; ++n) {
-		//TODO Does this need to be swapped with a comparison function?
-		if (pq->data[n]->value == data) {
+	struct slot *s = index_find(pq, data);
+	if (!s || !pq->is_more_urgent_than(priority, s->priority)) {
+		return false;
+	}
+
+	if (pq->buckets) {
+		// Leave a hole where it was, and queue it again as if new
+		struct bucket *b = &pq->buckets[(size_t)(s->priority / BUCKET_WIDTH)
+			& (pq->bucket_count - 1)];
+		void *value = b->items[s->pos].value;
+		b->items[s->pos].value = NULL;
+		index_remove(pq, s);
+		pq->size--;
+
+		if (bucket_enqueue(pq, priority, value)) {
 			return true;
+		} else if (!buckets_to_heap(pq)) {
+			return false;
 		}
+
+		return heap_insert(pq, priority, value);
+	}
+
+	heap_decrease(pq, s, priority);
+
+	return true;
+}
+
+static void heap_decrease(pqueue *pq, struct slot *s, double priority)
+{
+	s->priority = priority;
+	pq->data[s->pos].priority = priority;
+	bubble_up(pq, s->pos);
+}
+
+bool pqueue_contains(const pqueue *pq, const void *data)
+{
+	if (!pq || !data) {
+		return false;
 	}
 
-	return false;
+	return index_find(pq, data) != NULL;
 }
 
 double pqueue_get_priority(const pqueue *pq, const void *data)
@@ -207,14 +336,24 @@ double pqueue_get_priority(const pqueue *pq, const void *data)
 		return NAN;
 	}
 
-	for (size_t n=0; n < pq->size; ++n) {
-		//TODO Does this need to be swapped with a comparison function?
-		if (pq->data[n]->value == data) {
-			return pq->data[n]->priority;
-		}
-	}
+	struct slot *s = index_find(pq, data);
+
+	return s ? s->priority : NAN;
+}
+
+size_t pqueue_peak_size(const pqueue *pq)
+{
+	return pq ? pq->peak_size : 0;
+}
+
+size_t pqueue_stale_count(const pqueue *pq)
+{
+	return pq ? pq->stale_count : 0;
+}
 
-	return NAN;
+bool pqueue_is_bucketed(const pqueue *pq)
+{
+	return pq && pq->buckets;
 }
 
 void pqueue_destroy(pqueue *pq)
@@ -223,10 +362,245 @@ void pqueue_destroy(pqueue *pq)
 		return;
 	}
 
-	for (size_t n=0; n < pq->size; ++n) {
-		free(pq->data[n]);
+	if (pq->buckets) {
+		buckets_destroy(pq->buckets, pq->bucket_count);
 	}
 	free(pq->data);
+	free(pq->index);
 
 	free(pq);
 }
+
+static size_t hash(const void *value)
+{
+	// Low bits of an address are mostly alignment, so mix the high
+	// bits down before the mask throws them away
+	uint64_t hash = (uintptr_t)value;
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdu;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+static struct slot *index_find(const pqueue *pq, const void *value)
+{
+	size_t mask = pq->index_capacity - 1;
+	for (size_t n = hash(value) & mask; pq->index[n].value;
+			n = (n + 1) & mask) {
+		if (pq->index[n].value == value) {
+			return &pq->index[n];
+		}
+	}
+
+	return NULL;
+}
+
+static bool index_insert(pqueue *pq, const void *value, double priority,
+		size_t pos)
+{
+	if (2 * (pq->size + 1) > pq->index_capacity) {
+		size_t capacity = 2 * pq->index_capacity;
+		struct slot *bigger = calloc(capacity, sizeof(*bigger));
+		if (!bigger) {
+			return false;
+		}
+
+		for (size_t n=0; n < pq->index_capacity; ++n) {
+			if (!pq->index[n].value) {
+				continue;
+			}
+
+			size_t idx = hash(pq->index[n].value) & (capacity - 1);
+			while (bigger[idx].value) {
+				idx = (idx + 1) & (capacity - 1);
+			}
+			bigger[idx] = pq->index[n];
+			slot_node(pq, &bigger[idx])->slot = idx;
+		}
+
+		free(pq->index);
+		pq->index = bigger;
+		pq->index_capacity = capacity;
+	}
+
+	size_t mask = pq->index_capacity - 1;
+	size_t idx = hash(value) & mask;
+	while (pq->index[idx].value) {
+		idx = (idx + 1) & mask;
+	}
+
+	pq->index[idx].value = value;
+	pq->index[idx].priority = priority;
+	pq->index[idx].pos = pos;
+	slot_node(pq, &pq->index[idx])->slot = idx;
+
+	return true;
+}
+
+static void index_remove(pqueue *pq, struct slot *s)
+{
+	// Shift later members of the probe run back, so lookups never stop
+	// early at the hole this leaves
+	size_t mask = pq->index_capacity - 1;
+	size_t hole = s - pq->index;
+	size_t n = (hole + 1) & mask;
+	while (pq->index[n].value) {
+		size_t home = hash(pq->index[n].value) & mask;
+		if (((n - home) & mask) >= ((n - hole) & mask)) {
+			pq->index[hole] = pq->index[n];
+			slot_node(pq, &pq->index[hole])->slot = hole;
+			hole = n;
+		}
+		n = (n + 1) & mask;
+	}
+
+	pq->index[hole].value = NULL;
+}
+
+// The heap entry or bucket item that s tells the place of
+static struct node *slot_node(pqueue *pq, const struct slot *s)
+{
+	if (pq->buckets) {
+		struct bucket *b = &pq->buckets[(size_t)(s->priority / BUCKET_WIDTH)
+			& (pq->bucket_count - 1)];
+		return &b->items[s->pos];
+	}
+
+	return &pq->data[s->pos];
+}
+
+static bool bucket_enqueue(pqueue *pq, double priority, void *data)
+{
+	double key = priority / BUCKET_WIDTH;
+	if (pq->size == 0 && key >= 0 && key < (double)SIZE_MAX / 2) {
+		// Nothing queued yet, so the ring may start anywhere
+		pq->base = key;
+	}
+
+	// Keys must be whole, and no lower than the last one dequeued
+	if (!(key >= pq->base) || key - pq->base >= MAX_BUCKET_SPAN
+			|| key - (size_t)key > 0) {
+		return false;
+	}
+
+	size_t offset = (size_t)key - pq->base;
+	if (offset >= pq->bucket_count) {
+		size_t count = 2 * pq->bucket_count;
+		while (count <= offset) {
+			count *= 2;
+		}
+
+		struct bucket *bigger = calloc(count, sizeof(*bigger));
+		if (!bigger) {
+			return false;
+		}
+
+		for (size_t k=pq->base; k < pq->base + pq->bucket_count; ++k) {
+			bigger[k & (count - 1)] = pq->buckets[k & (pq->bucket_count - 1)];
+		}
+
+		free(pq->buckets);
+		pq->buckets = bigger;
+		pq->bucket_count = count;
+	}
+
+	struct bucket *b = &pq->buckets[(size_t)key & (pq->bucket_count - 1)];
+	if (b->size == b->capacity) {
+		size_t capacity = b->capacity ? 2 * b->capacity : DEFAULT_CAPACITY;
+		struct node *bigger = realloc(b->items, capacity * sizeof(*bigger));
+		if (!bigger) {
+			return false;
+		}
+
+		b->items = bigger;
+		b->capacity = capacity;
+	}
+
+	b->items[b->size].priority = priority;
+	b->items[b->size].value = data;
+	if (!index_insert(pq, data, priority, b->size)) {
+		return false;
+	}
+	b->size++;
+	pq->size++;
+	if (pq->size > pq->peak_size) {
+		pq->peak_size = pq->size;
+	}
+
+	return true;
+}
+
+static void *bucket_dequeue(pqueue *pq, double *priority)
+{
+	// Something is queued, so this stops within one trip around the ring
+	while (true) {
+		struct bucket *b = &pq->buckets[pq->base & (pq->bucket_count - 1)];
+		while (b->head < b->size && !b->items[b->head].value) {
+			b->head++;
+			pq->stale_count++;
+		}
+
+		if (b->head < b->size) {
+			struct node *first = &b->items[b->head++];
+			index_remove(pq, &pq->index[first->slot]);
+			pq->size--;
+			if (priority) {
+				*priority = first->priority;
+			}
+
+			return first->value;
+		}
+
+		b->head = b->size = 0;
+		pq->base++;
+	}
+}
+
+static bool buckets_to_heap(pqueue *pq)
+{
+	size_t capacity = pq->capacity;
+	while (capacity < pq->size) {
+		capacity *= 2;
+	}
+
+	struct node *data = realloc(pq->data, capacity * sizeof(*data));
+	if (!data) {
+		return false;
+	}
+	pq->data = data;
+	pq->capacity = capacity;
+
+	// The index is rebuilt as everything goes into the heap
+	memset(pq->index, 0, pq->index_capacity * sizeof(*pq->index));
+
+	// The heap has room for every item and the index already held them
+	// all, so nothing here should need more memory; if it does anyway,
+	// the items that could not be moved are lost, and the caller told
+	struct bucket *buckets = pq->buckets;
+	pq->buckets = NULL;
+	pq->size = 0;
+	bool moved = true;
+	for (size_t b=0; b < pq->bucket_count; ++b) {
+		for (size_t n=buckets[b].head; n < buckets[b].size; ++n) {
+			if (buckets[b].items[n].value
+					&& !heap_insert(pq, buckets[b].items[n].priority,
+						buckets[b].items[n].value)) {
+				moved = false;
+			}
+		}
+	}
+
+	buckets_destroy(buckets, pq->bucket_count);
+	pq->bucket_count = 0;
+
+	return moved;
+}
+
+static void buckets_destroy(struct bucket *buckets, size_t count)
+{
+	for (size_t b=0; b < count; ++b) {
+		free(buckets[b].items);
+	}
+	free(buckets);
+}
@@ -2,25 +2,55 @@
 #define PQUEUE_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 typedef struct pq_ pqueue;
 
-enum pqueue_type { MIN_PQUEUE, MAX_PQUEUE };
+// BUCKET_PQUEUE is a MIN_PQUEUE for priorities that are whole multiples
+// of 0.5 (like sums of maze weights) and never below the last one
+// dequeued, as in Dijkstra's algorithm.  It files items into a bucket per
+// priority, for O(1) enqueue and amortized O(1) dequeue; items sharing a
+// priority come out in the order they went in.  The first priority that
+// does not fit quietly moves everything over to the binary heap the other
+// types use.
+enum pqueue_type { MIN_PQUEUE, MAX_PQUEUE, BUCKET_PQUEUE };
 
 pqueue *pqueue_create(enum pqueue_type type);
 
 bool pqueue_is_empty(const pqueue *pq);
 
-//TODO
+// O(1); items are told apart by address
 bool pqueue_contains(const pqueue *pq, const void *data);
 
-//TODO
+// O(1); returns NAN if data is not queued
 double pqueue_get_priority(const pqueue *pq, const void *data);
 
+// Each item can only be queued once at a time; returns false if data is
+// already queued (see pqueue_decrease_priority) or memory runs out.  A
+// BUCKET_PQUEUE that runs out while moving over to the heap may have lost
+// items queued before, so it is only fit to be destroyed.
 bool pqueue_enqueue(pqueue *pq, double priority, void *data);
 
+// Makes queued data more urgent, in O(log n) for the heap types and O(1)
+// for BUCKET_PQUEUE.  Returns false if data is not queued, priority is no
+// more urgent than the one it has, or memory runs out, as with
+// pqueue_enqueue.
+bool pqueue_decrease_priority(pqueue *pq, const void *data, double priority);
+
 void *pqueue_dequeue(pqueue *pq, double *priority);
 
+// The most items that have been queued at once
+size_t pqueue_peak_size(const pqueue *pq);
+
+// How many of the places left behind by pqueue_decrease_priority have been
+// passed over on the way to the next item; always 0 for the heap types,
+// which move items in place
+size_t pqueue_stale_count(const pqueue *pq);
+
+// Whether a BUCKET_PQUEUE is still filing items into buckets, rather than
+// having moved over to the heap; always false for the heap types
+bool pqueue_is_bucketed(const pqueue *pq);
+
 void pqueue_destroy(pqueue *pq);
 
 
@@ -1,6 +1,13 @@
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
+#include <time.h>
 #include <unistd.h>
 #include "lib/graph.h"		// libraries and dependencies taken from Liam Echlin
 #include "lib/path.h"
@@ -13,32 +20,232 @@ enum {
 	INVALID_MAP = 4
 };
 
-union int_as_void {
-	long num;		// TODO: Change this to long
-	void *ptr;
+enum solver {
+	DIJKSTRA,
+	ASTAR,
+	BIDIRECTIONAL,
+	JUMP_POINTS,
+	DELTA_STEPPING,
+	PATH_TREE
 };
 
+enum stats_format {
+	NO_STATS,
+	TEXT_STATS,
+	JSON_STATS
+};
+
+// Stages of solving a maze, as timed for --stats
+enum phase {
+	LOAD_PHASE,
+	GRAPH_PHASE,
+	FLOOD_PHASE,
+	SEARCH_PHASE,
+	PRINT_PHASE,
+	PHASE_COUNT
+};
+
+static const struct {
+	const char *key;	// for JSON
+	const char *label;	// for people
+} PHASES[PHASE_COUNT] = {
+	{"load", "Loading"},
+	{"graph", "Building graph"},
+	{"flood_fill", "Flood fill"},
+	{"search", "Searching"},
+	{"print", "Printing"}
+};
+
+// Set once before any maze is solved, and only read after that
 static struct {
 	bool doors;
 	bool water;
-} options = { false, false };
+	bool mapped;
+	bool compact;
+	bool list;
+	enum stats_format stats;
+	size_t workers;
+	size_t threads;
+	enum solver solver;
+} options = { false, false, false, false, false, NO_STATS, 1, 1, DIJKSTRA };
+
+// What the A* heuristic needs to know about the maze
+struct estimate_info {
+	size_t width;
+	double min_weight;
+};
+
+// What flooding the maze out from the start ran into
+enum reach {
+	UNBOUNDED,		// the 'X' ring past the edge, so the maze leaks
+	FINISH_REACHED,
+	FINISH_UNREACHED,
+	REACH_UNKNOWN		// ran out of memory before finding out
+};
+
+// Where the start and finish turned up in the maze file, [0] being the
+// start and [1] the finish
+struct ends {
+	bool found[2];
+	size_t row[2];
+	size_t col[2];
+};
+
+// Cells waiting to be visited by the flood fill, as a ring that only has
+// to hold the edge of the area flooded so far; capacity is a power of two
+struct cell_queue {
+	size_t *cells;
+	size_t head;
+	size_t size;
+	size_t capacity;
+};
+
+enum { CELL_QUEUE_START = 1024 };
+
+// Rendered rows are written out once this much has built up
+enum { OUTPUT_BUFFER_SIZE = 1 << 16 };
+
+// Passes over a whole mapped maze let go of the pages they have read every
+// this many cells, so that only the search's own pages stay resident
+enum { RELEASE_CELLS = 1 << 20 };
 
-char *maze;			// global so that add_path can modify 
+// Running total of what the cells of a path cost to step onto
+struct cost_sum {
+	const grid *cells;
+	double cost;
+};
+
+// Path cells, sorted into the order they are printed in
+struct overlay {
+	size_t *cells;
+	size_t count;
+};
+
+// One maze file of a batch; what solving it prints is held back until
+// every file before it has been written out
+struct job {
+	const char *path;
+	char *out;
+	size_t out_size;
+	char *err;
+	size_t err_size;
+	int status;
+	bool done;
+};
 
-int maze_node_cmp(const void *src, const void *dst);
-void dimensions_of_maze(FILE * fo, int *height, int *width);
+// Workers claim jobs in order, and the main thread writes them out in
+// order as they are done
+struct batch {
+	struct job *jobs;
+	size_t count;
+	size_t next;		// First job no worker has claimed yet
+	pthread_mutex_t lock;
+	pthread_cond_t finished;
+};
+
+int solve_maze(const char *filename, FILE * out, FILE * err);
+int solve_batch(char **paths, size_t count);
+void *work(void *arg);
+bool read_paths(FILE * input, char ***paths, size_t *count);
 double find_weight(char target);
-graph *load_maze(FILE * fo, char **maze, int height, int width);
-void add_path(void *data);
+double cheapest_weight(const char *symbols);
+double manhattan_estimate(const void *from, const void *to, void *arg);
+int load_maze(FILE * fo, const char *valid_set, grid ** cells, size_t *start,
+	      size_t *finish, FILE * err);
+int map_maze(FILE * fo, const char *valid_set, grid ** cells,
+	     unsigned char **open, size_t *start, size_t *finish, FILE * err);
+int pack_maze(FILE * fo, const char *valid_set, grid ** cells, size_t *start,
+	      size_t *finish, FILE * err);
+void allow_symbols(const char *valid_set, bool allowed[UCHAR_MAX + 1]);
+bool scan_line(const char *line, size_t length,
+	       const bool allowed[UCHAR_MAX + 1], size_t row,
+	       struct ends *ends, FILE * err);
+int check_ends(const struct ends *ends, size_t rows, FILE * err);
+unsigned char *open_cells(const grid * cells);
+enum reach flood_fill(const grid * cells, unsigned char *open, size_t start,
+		      size_t finish, FILE * err);
+bool cell_queue_push(struct cell_queue *q, size_t cell);
+int print_maze(const grid * cells, list * path, FILE * out, FILE * err);
+void print_stats(const graph * g, const double seconds[PHASE_COUNT],
+		 double cost, FILE * err);
+double path_cost(const grid * cells, list * path);
+void add_cost(void *data, void *arg);
+void count_edge(size_t id, double weight, void *arg);
+double lap(struct timespec *mark);
+void add_path(void *data, void *arg);
+int compare_cells(const void *a, const void *b);
 
 int main(int argc, char *argv[])
 {
+	static const struct option long_options[] = {
+		{"stats", optional_argument, NULL, 's'},
+		{NULL, 0, NULL, 0}
+	};
+
 	int opt;
-	while ((opt = getopt(argc, argv, "dw")) != -1) {
+	while ((opt = getopt_long(argc, argv, "abcdJj:lmsTt:w", long_options,
+				  NULL)) != -1) {
 		switch (opt) {
+		case 'a':
+			options.solver = ASTAR;
+			break;
+		case 'b':
+			options.solver = BIDIRECTIONAL;
+			break;
+		case 'c':
+			options.compact = true;
+			break;
 		case 'd':
 			options.doors = true;
 			break;
+		case 'J':
+			options.solver = JUMP_POINTS;
+			break;
+		case 'j':
+			{
+				char *end;
+				long workers = strtol(optarg, &end, 10);
+				if (*end || workers < 1) {
+					fprintf(stderr,
+						"Error: -j needs a positive number of workers\n");
+					return (INVOCATION_ERROR);
+				}
+				options.workers = workers;
+			}
+			break;
+		case 'l':
+			options.list = true;
+			break;
+		case 'm':
+			options.mapped = true;
+			break;
+		case 's':
+			if (!optarg || !strcmp(optarg, "text")) {
+				options.stats = TEXT_STATS;
+			} else if (!strcmp(optarg, "json")) {
+				options.stats = JSON_STATS;
+			} else {
+				fprintf(stderr,
+					"Error: --stats takes text or json\n");
+				return (INVOCATION_ERROR);
+			}
+			break;
+		case 'T':
+			options.solver = PATH_TREE;
+			break;
+		case 't':
+			{
+				char *end;
+				long threads = strtol(optarg, &end, 10);
+				if (*end || threads < 1) {
+					fprintf(stderr,
+						"Error: -t needs a positive number of threads\n");
+					return (INVOCATION_ERROR);
+				}
+				options.threads = threads;
+				options.solver = DELTA_STEPPING;
+			}
+			break;
 		case 'w':
 			options.water = true;
 			break;
@@ -50,155 +257,849 @@ int main(int argc, char *argv[])
 	argc -= optind;
 	argv += optind;
 
-	if (argc != 1) {
-		fprintf(stderr, "Usage: ./maze mazefile\n");
-		return INVOCATION_ERROR;
+	if (argc == 1 && !options.list) {
+		// Case: one maze, solved just as it always has been
+		return solve_maze(argv[0], stdout, stderr);
+	}
+
+	// The file names are borrowed from argv, or read in from stdin
+	char **paths = malloc((argc + 1) * sizeof(*paths));
+	if (!paths) {
+		fprintf(stderr, "Memory allocation error");
+		return MEMORY_ERROR;
+	}
+	memcpy(paths, argv, argc * sizeof(*paths));
+	size_t count = argc;
+	int status = INVOCATION_ERROR;
+	if (options.list && !read_paths(stdin, &paths, &count)) {
+		fprintf(stderr, "Memory allocation error");
+		status = MEMORY_ERROR;
+	} else if (count == 0) {
+		fprintf(stderr, "Usage: ./maze mazefile...\n");
+	} else {
+		status = solve_batch(paths, count);
 	}
 
-	FILE *fo = fopen(argv[0], "r");
+	for (size_t n = argc; n < count; ++n) {
+		free(paths[n]);
+	}
+	free(paths);
+	return status;
+}
+
+int solve_maze(const char *filename, FILE * out, FILE * err)
+{
+	FILE *fo = fopen(filename, "r");
 	if (!fo) {
-		perror("Could not open maze file");
+		fprintf(err, "Could not open maze file: %s\n", strerror(errno));
 		return FILE_ERROR;
 	}
-	int height;
-	int width;
-	dimensions_of_maze(fo, &height, &width);
-	graph *g = load_maze(fo, &maze, height, width);
-	// Add null terminator before using string functions on maze
-	memset(maze + height * width, '\0', 1);
 	char valid_set[10];	// Enough space to fit all valid chars
 	snprintf(valid_set, 10, " #@>X%s%s", options.doors ? "/+" : "",
 		 options.water ? "~" : "");
-	if (strlen(maze) != strspn(maze, valid_set)) {
-		// Case: found disallowed symbols in maze
-		fprintf(stderr, "Error: invalid symbol(s) in maze\n");
-		graph_destroy(g);
-		free(maze);
+	// Each phase is timed whether or not anyone asks, as that costs next
+	// to nothing
+	double seconds[PHASE_COUNT] = { 0 };
+	struct timespec mark;
+	clock_gettime(CLOCK_MONOTONIC, &mark);
+
+	grid *cells;
+	// Which cells can be crossed, one bit each, if the loader worked that
+	// out on its way through
+	unsigned char *open = NULL;
+	// Cell indices double as node ids in the grid graph
+	size_t start;
+	size_t finish;
+	int status;
+	if (options.mapped) {
+		status = map_maze(fo, valid_set, &cells, &open, &start, &finish,
+				  err);
+	} else if (options.compact) {
+		status = pack_maze(fo, valid_set, &cells, &start, &finish, err);
+	} else {
+		status = load_maze(fo, valid_set, &cells, &start, &finish, err);
+	}
+	if (status != SUCCESS) {
 		fclose(fo);
-		return (INVALID_MAP);
-	} else if (strlen(maze) == 4) {
-		// Case: file was empty (2x2 of 'X' is created by default)
-		fprintf(stderr, "Error: empty file\n");
-		graph_destroy(g);
-		free(maze);
+		return status;
+	}
+	seconds[LOAD_PHASE] = lap(&mark);
+
+	// Neighbors and weights are worked out from the cells as the search
+	// asks for them, so no per-cell nodes or edges are built
+	graph *g = graph_create_grid(cells, find_weight);
+	if (!g) {
+		fprintf(err, "Memory allocation error");
+		grid_destroy(cells);
 		fclose(fo);
-		return (INVALID_MAP);
+		return MEMORY_ERROR;
 	}
-	union int_as_void start = {.num = (strchr(maze, '@')) - maze };
-	union int_as_void finish = {.num = (strchr(maze, '>')) - maze };
-	union int_as_void test_finish = {.num = 1 };	// Boundary at index 1
-	list *test_path = dijkstra_path(g, start.ptr, test_finish.ptr);
-	if (list_size(test_path) != 0 && list_size(test_path) != 1) {
-		// Case: maze was not fully bounded, successful path was
-		// found to the boundary node at index 1.
-		fprintf(stderr, "Error: unbounded maze\n");
+	seconds[GRAPH_PHASE] = lap(&mark);
+
+	if (!open) {
+		open = open_cells(cells);
+	}
+	enum reach reach = REACH_UNKNOWN;
+	if (open) {
+		reach = flood_fill(cells, open, start, finish, err);
+	} else {
+		fprintf(err, "Memory allocation error");
+	}
+	free(open);
+	seconds[FLOOD_PHASE] = lap(&mark);
+	if (reach == REACH_UNKNOWN) {
+		graph_destroy(g);
+		grid_destroy(cells);
+		fclose(fo);
+		return MEMORY_ERROR;
+	} else if (reach == UNBOUNDED) {
+		// Case: maze was not fully bounded, the start can walk out
+		// onto the boundary nodes
+		fprintf(err, "Error: unbounded maze\n");
 		graph_destroy(g);
-		list_destroy(test_path);
-		free(maze);
+		grid_destroy(cells);
 		fclose(fo);
 		return (INVALID_MAP);
 	}
 
-	list *path = dijkstra_path(g, start.ptr, finish.ptr);
-	list_iterate(path, add_path);
+	list *path;
+	path_reset_stats();
+	if (reach == FINISH_UNREACHED) {
+		// Case: no path, so there is nothing to search for
+		path = list_create(NULL);
+	} else if (options.solver == JUMP_POINTS) {
+		struct estimate_info info = { grid_width(cells),
+			cheapest_weight(valid_set)
+		};
+		path = jps_path_ids(g, start, finish, manhattan_estimate, &info);
+	} else if (options.solver == BIDIRECTIONAL) {
+		path = bidirectional_path_ids(g, start, finish);
+	} else if (options.solver == DELTA_STEPPING) {
+		// Buckets as wide as a step across open floor: water and closed
+		// doors cost more, so their edges are the heavy ones
+		path = delta_stepping_path_ids(g, start, finish, find_weight(' '),
+					       options.threads);
+	} else if (options.solver == PATH_TREE) {
+		// Every cheapest path out from the start, of which only the
+		// finish's is read
+		path_tree *tree = path_tree_create_ids(g, start);
+		path = tree ? path_tree_path_to_id(tree, finish) : NULL;
+		path_tree_destroy(tree);
+	} else {
+		// A compact maze is searched with compact tables too, as those
+		// take far more memory than the cells
+		dijkstra_ctx *ctx = options.compact ?
+		    dijkstra_ctx_create_compact(g) : dijkstra_ctx_create(g);
+		struct estimate_info info = { grid_width(cells),
+			cheapest_weight(valid_set)
+		};
+		if (options.solver == ASTAR) {
+			dijkstra_ctx_set_heuristic(ctx, manhattan_estimate, &info);
+		}
+		path = dijkstra_ctx_path_ids(ctx, start, finish);
+		dijkstra_ctx_destroy(ctx);
+	}
+	seconds[SEARCH_PHASE] = lap(&mark);
+
+	if (!path) {
+		fprintf(err, "Memory allocation error");
+		status = MEMORY_ERROR;
+	} else {
+		status = print_maze(cells, path, out, err);
+	}
+	seconds[PRINT_PHASE] = lap(&mark);
+	if (options.stats != NO_STATS) {
+		print_stats(g, seconds, path ? path_cost(cells, path) : INFINITY,
+			    err);
+	}
+
+	graph_destroy(g);
+	list_destroy(path);
+	grid_destroy(cells);
+	fclose(fo);
+	return status;
+}
+
+
+int solve_batch(char **paths, size_t count)
+{
+	struct batch batch = { NULL, count, 0, PTHREAD_MUTEX_INITIALIZER,
+		PTHREAD_COND_INITIALIZER
+	};
+	batch.jobs = calloc(count, sizeof(*batch.jobs));
+	size_t workers = options.workers < count ? options.workers : count;
+	pthread_t *threads = malloc(workers * sizeof(*threads));
+	if (!batch.jobs || !threads) {
+		fprintf(stderr, "Memory allocation error");
+		free(batch.jobs);
+		free(threads);
+		return MEMORY_ERROR;
+	}
+	for (size_t n = 0; n < count; ++n) {
+		batch.jobs[n].path = paths[n];
+	}
+
+	size_t started = 0;
+	while (started < workers
+	       && pthread_create(&threads[started], NULL, work, &batch) == 0) {
+		++started;
+	}
+	if (started == 0) {
+		// Case: no threads to be had, so get on with it here
+		work(&batch);
+	}
+
+	// Each file is headed by its name and how solving it went
+	int status = SUCCESS;
+	for (size_t n = 0; n < count; ++n) {
+		struct job *job = &batch.jobs[n];
+		pthread_mutex_lock(&batch.lock);
+		while (!job->done) {
+			pthread_cond_wait(&batch.finished, &batch.lock);
+		}
+		pthread_mutex_unlock(&batch.lock);
+
+		printf("==> %s [%d] <==\n", job->path, job->status);
+		fwrite(job->out, 1, job->out_size, stdout);
+		if (job->err_size > 0) {
+			// Keep the error beside the file it is about
+			fflush(stdout);
+			fprintf(stderr, "%s: ", job->path);
+			fwrite(job->err, 1, job->err_size, stderr);
+		}
+		free(job->out);
+		free(job->err);
+
+		if (status == SUCCESS) {
+			status = job->status;
+		}
+	}
+
+	for (size_t n = 0; n < started; ++n) {
+		pthread_join(threads[n], NULL);
+	}
+	free(threads);
+	free(batch.jobs);
+	return status;
+}
 
-	//Print array
-	for (int i = 0; i < height; ++i) {
-		for (int j = 0; j < width; ++j) {
-			if (maze[j + (width * i)] != 'X') {
-				printf("%.1s", maze + (j + (width * i)));
+void *work(void *arg)
+{
+	struct batch *batch = arg;
+	while (true) {
+		pthread_mutex_lock(&batch->lock);
+		size_t n = batch->next;
+		if (n < batch->count) {
+			++batch->next;
+		}
+		pthread_mutex_unlock(&batch->lock);
+		if (n >= batch->count) {
+			break;
+		}
+
+		struct job *job = &batch->jobs[n];
+		FILE *out = open_memstream(&job->out, &job->out_size);
+		FILE *err = open_memstream(&job->err, &job->err_size);
+		if (out && err) {
+			job->status = solve_maze(job->path, out, err);
+		} else {
+			job->status = MEMORY_ERROR;
+		}
+		if (out) {
+			fclose(out);
+		}
+		if (err) {
+			fclose(err);
+		}
+
+		pthread_mutex_lock(&batch->lock);
+		job->done = true;
+		pthread_cond_broadcast(&batch->finished);
+		pthread_mutex_unlock(&batch->lock);
+	}
+
+	return NULL;
+}
+
+bool read_paths(FILE * input, char ***paths, size_t *count)
+{
+	// paths has room for count + 1 names to begin with
+	size_t capacity = *count + 1;
+	char *line_buf = NULL;
+	size_t buf_size = 0;
+	ssize_t read;
+	while ((read = getline(&line_buf, &buf_size, input)) != -1) {
+		if (read > 0 && line_buf[read - 1] == '\n') {
+			line_buf[--read] = '\0';
+		}
+		if (read == 0) {
+			continue;
+		}
+
+		if (*count == capacity) {
+			capacity *= 2;
+			char **tmp = realloc(*paths, capacity * sizeof(**paths));
+			if (!tmp) {
+				free(line_buf);
+				return false;
 			}
+			*paths = tmp;
+		}
+		(*paths)[*count] = strdup(line_buf);
+		if (!(*paths)[*count]) {
+			free(line_buf);
+			return false;
+		}
+		++*count;
+	}
+	free(line_buf);
+
+	return true;
+}
+
+int print_maze(const grid * cells, list * path, FILE * out, FILE * err)
+{
+	size_t height = grid_height(cells);
+	size_t width = grid_width(cells);
+
+	// The path is marked on each row as it is rendered, rather than
+	// written into the cells, since a mapped maze cannot be written to
+	struct overlay overlay = { NULL, 0 };
+	overlay.cells = malloc(list_size(path) * sizeof(*overlay.cells) + 1);
+	// Rows are gathered up and written out a buffer at a time
+	size_t capacity = width + 1 > OUTPUT_BUFFER_SIZE ? width + 1
+	    : OUTPUT_BUFFER_SIZE;
+	char *buffer = malloc(capacity);
+	char *row = malloc(width);
+	if (!overlay.cells || !buffer || !row) {
+		fprintf(err, "Memory allocation error");
+		free(overlay.cells);
+		free(buffer);
+		free(row);
+		return MEMORY_ERROR;
+	}
+	list_iterate_r(path, add_path, &overlay);
+	qsort(overlay.cells, overlay.count, sizeof(*overlay.cells),
+	      compare_cells);
+
+	size_t used = 0;
+	size_t next = 0;	// First path cell not yet rendered
+	for (size_t i = 0; i < height; ++i) {
+		grid_copy_row(cells, i, row);
+		if ((i + 1) % (RELEASE_CELLS / width + 1) == 0) {
+			grid_release(cells);
+		}
+		for (; next < overlay.count
+		     && overlay.cells[next] < (i + 1) * width; ++next) {
+			char *cell = row + (overlay.cells[next] - i * width);
+			if (*cell != '@' && *cell != '>') {
+				*cell = '.';
+			}
+		}
+
+		if (used + width + 1 > capacity) {
+			fwrite(buffer, 1, used, out);
+			used = 0;
+		}
+		// The 'X' cells, ring and all, are left out; runs of anything
+		// else are copied across whole
+		const char *from = row;
+		const char *end = row + width;
+		while (from < end) {
+			const char *x = memchr(from, 'X', end - from);
+			size_t run = (x ? x : end) - from;
+			memcpy(buffer + used, from, run);
+			used += run;
+			from += run + 1;
 		}
 		if (i != 0 && i != height - 1) {
 			// Avoid unnecessary newlines for start and end of maze
-			putchar('\n');
+			buffer[used++] = '\n';
 		}
-
 	}
+	fwrite(buffer, 1, used, out);
 
-	graph_destroy(g);
-	list_destroy(test_path);
-	list_destroy(path);
-	free(maze);
-	fclose(fo);
+	free(overlay.cells);
+	free(buffer);
+	free(row);
 	return SUCCESS;
 }
 
-void add_path(void *data)
+// Where the time went and what the search did, for sizing up slow solves
+void print_stats(const graph * g, const double seconds[PHASE_COUNT],
+		 double cost, FILE * err)
 {
-	if (maze[(long)data] != '@' && maze[(long)data] != '>') {
-		maze[(long)data] = '.';
+	// Read before the edges are counted, whose pass over a mapped maze
+	// would otherwise bring all of it in
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	struct path_stats search;
+	path_get_stats(&search);
+
+	// Only counted when asked for, since it means a pass over the maze
+	size_t nodes = graph_size(g);
+	size_t edges = 0;
+	for (size_t id = 0; id < graph_id_bound(g); ++id) {
+		if (graph_node_data(g, id)) {
+			graph_iterate_neighbor_ids(g, id, count_edge, &edges);
+		}
 	}
-	return;
+
+
+	if (options.stats == JSON_STATS) {
+		fprintf(err, "{\"seconds\": {");
+		for (size_t n = 0; n < PHASE_COUNT; ++n) {
+			fprintf(err, "%s\"%s\": %.6f", n ? ", " : "",
+				PHASES[n].key, seconds[n]);
+		}
+		fprintf(err, "}, \"graph_nodes\": %zu, \"graph_edges\": %zu, "
+			"\"nodes_dequeued\": %zu, \"nodes_expanded\": %zu, "
+			"\"edges_relaxed\": %zu, \"stale_entries\": %zu, "
+			"\"peak_queued\": %zu, \"peak_rss_kib\": %ld, "
+			"\"path_cost\": ",
+			nodes, edges, search.dequeued, search.expanded,
+			search.relaxed, search.stale, search.peak_queued,
+			usage.ru_maxrss);
+		// JSON has no infinity, so a maze with no path costs null
+		if (isinf(cost)) {
+			fprintf(err, "null}\n");
+		} else {
+			fprintf(err, "%g}\n", cost);
+		}
+		return;
+	}
+
+	for (size_t n = 0; n < PHASE_COUNT; ++n) {
+		fprintf(err, "%s: %.6f s\n", PHASES[n].label, seconds[n]);
+	}
+	fprintf(err, "Graph nodes: %zu\n", nodes);
+	fprintf(err, "Graph edges: %zu\n", edges);
+	fprintf(err, "Nodes dequeued: %zu\n", search.dequeued);
+	fprintf(err, "Nodes expanded: %zu\n", search.expanded);
+	fprintf(err, "Edges relaxed: %zu\n", search.relaxed);
+	fprintf(err, "Stale entries popped: %zu\n", search.stale);
+	fprintf(err, "Peak queue size: %zu\n", search.peak_queued);
+	fprintf(err, "Peak memory: %ld KiB\n", usage.ru_maxrss);
+	fprintf(err, "Path cost: %g\n", cost);
+}
+
+// What it costs to walk path from the start, or INFINITY if it is empty,
+// as there is no path at all then
+double path_cost(const grid * cells, list * path)
+{
+	if (list_size(path) == 0) {
+		return (INFINITY);
+	}
+	struct cost_sum sum = { cells, 0 };
+	list_iterate_r(path, add_cost, &sum);
+	return (sum.cost);
+}
+
+// Each step costs whatever it steps onto, as in the grid graph
+void add_cost(void *data, void *arg)
+{
+	struct cost_sum *sum = arg;
+	sum->cost += find_weight(grid_cell(sum->cells, (size_t)data));
+}
+
+void count_edge(size_t id, double weight, void *arg)
+{
+	(void)id;
+	(void)weight;
+	++*(size_t *) arg;
+}
+
+// Seconds since *mark, which then moves up to now
+double lap(struct timespec *mark)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	double seconds = (now.tv_sec - mark->tv_sec)
+	    + (now.tv_nsec - mark->tv_nsec) / 1e9;
+	*mark = now;
+	return (seconds);
+}
+
+void add_path(void *data, void *arg)
+{
+	struct overlay *overlay = arg;
+	overlay->cells[overlay->count++] = (size_t)data;
 }
 
-int maze_node_cmp(const void *src, const void *dst)
+int compare_cells(const void *a, const void *b)
 {
-	return (long)src - (long)dst;
+	size_t left = *(const size_t *)a;
+	size_t right = *(const size_t *)b;
+	return (left > right) - (left < right);
 }
 
-graph *load_maze(FILE * fo, char **maze, int height, int width)
+int load_maze(FILE * fo, const char *valid_set, grid ** cells, size_t *start,
+	      size_t *finish, FILE * err)
 {
+	bool allowed[UCHAR_MAX + 1];
+	allow_symbols(valid_set, allowed);
+
+	// Rows are packed end to end as they are read, then spread out to
+	// the full width once the longest one is known
+	char *packed = NULL;
+	size_t used = 0;
+	size_t capacity = 0;
+	size_t *lengths = NULL;
+	size_t rows = 0;
+	size_t row_capacity = 0;
+	size_t longest = 0;
+
+	struct ends ends = { { false, false }, { 0, 0 }, { 0, 0 } };
+	int status = SUCCESS;
 	char *line_buf = NULL;
 	size_t buf_size = 0;
-	*maze = malloc(((height * width)) * sizeof(**maze) + 1);
-	if (!*maze) {
-		fprintf(stderr, "Memory allocation error");
-		exit(MEMORY_ERROR);
-	}
-
-	memset(*maze, ' ', width * height);	// Set all bytes except last to ' '
-	memset(*maze, 'X', width);	// Top row
-	memset(*maze + ((height * width) - width), 'X', width);	// Bottom row
-	size_t counter = 1;	// Offset from top row
-	while (getline(&line_buf, &buf_size, fo) != -1) {
-		if (strchr(line_buf, '\n')) {
-			char *tmp = strchr(line_buf, '\n');
-			*tmp = ' ';
-		}
-		memset(*maze + (width * counter), 'X', 1);
-		memcpy(*maze + (width * counter + 1), line_buf,
-		       strlen(line_buf));
-		memset(*maze + (width * counter + (width - 1)), 'X', 1);
-		++counter;
-	}
-
-	graph *g = graph_create(maze_node_cmp, NULL);
-	for (int i = 0; i < height * width - 1; ++i) {
-		// Known bug: index 0 doesn't get added to the graph because '0'
-		// is treated as a false value by graph_add_node. There are no 
-		// explicit consequences of this bug, given that it is a boundary node,
-		// but it personally annoys me.
-		if ((*maze + i)[0] == '#') {
-			continue;
+	ssize_t read;
+	while ((read = getline(&line_buf, &buf_size, fo)) != -1) {
+		size_t length = read;
+		if (length > 0 && line_buf[length - 1] == '\n') {
+			--length;
 		}
-		union int_as_void num = {.num = i };
-		graph_add_node(g, num.ptr);
-		if (i % width != 0) {
-			// Case: node has left neighbor
-			union int_as_void curr = {.num = i };
-			union int_as_void prev = {.num = i - 1 };
-			graph_add_edge(g, prev.ptr, curr.ptr,
-				       find_weight((*maze + i)[0]));
-			graph_add_edge(g, curr.ptr, prev.ptr,
-				       find_weight((*maze + i - 1)[0]));
+		if (!scan_line(line_buf, length, allowed, rows, &ends, err)) {
+			status = INVALID_MAP;
+			break;
 		}
-		if ((i - width) >= 0) {
-			// Case: node has an above neighbor
-			union int_as_void curr = {.num = i };
-			union int_as_void up = {.num = i - width };
-			graph_add_edge(g, up.ptr, curr.ptr,
-				       find_weight((*maze + i)[0]));
-			graph_add_edge(g, curr.ptr, up.ptr,
-				       find_weight((*maze + i - width)[0]));
+
+		if (rows == row_capacity) {
+			row_capacity = row_capacity ? 2 * row_capacity : 64;
+			size_t *tmp = realloc(lengths,
+					      row_capacity * sizeof(*lengths));
+			if (!tmp) {
+				status = MEMORY_ERROR;
+				break;
+			}
+			lengths = tmp;
+		}
+		if (!packed || used + length > capacity) {
+			do {
+				capacity = capacity ? 2 * capacity : 4096;
+			} while (used + length > capacity);
+			char *tmp = realloc(packed, capacity);
+			if (!tmp) {
+				status = MEMORY_ERROR;
+				break;
+			}
+			packed = tmp;
+		}
+
+		memcpy(packed + used, line_buf, length);
+		used += length;
+		lengths[rows++] = length;
+		if (length > longest) {
+			longest = length;
 		}
 	}
+	free(line_buf);
 
-	if (line_buf) {
-		free(line_buf);
+	if (status == SUCCESS) {
+		status = check_ends(&ends, rows, err);
 	}
 
-	return (g);
+	// Height and width are 2 more than the file's, because there is a
+	// box of 'X's representing boundary nodes that rings the entire maze
+	size_t full_width = longest + 2;
+	size_t full_height = rows + 2;
+	char *grown = NULL;
+	if (status == SUCCESS) {
+		grown = realloc(packed, full_width * full_height + 1);
+		if (!grown) {
+			status = MEMORY_ERROR;
+		}
+	}
+	if (status != SUCCESS) {
+		if (status == MEMORY_ERROR) {
+			fprintf(err, "Memory allocation error");
+		}
+		free(packed);
+		free(lengths);
+		return status;
+	}
+
+	// Each row only moves later in the buffer, so working back from the
+	// last one never overwrites a row that has yet to move
+	for (size_t row = rows; row-- > 0;) {
+		used -= lengths[row];
+		char *dest = grown + full_width * (row + 1);
+		memmove(dest + 1, grown + used, lengths[row]);
+		dest[0] = 'X';
+		memset(dest + 1 + lengths[row], ' ', longest - lengths[row]);
+		dest[full_width - 1] = 'X';
+	}
+	memset(grown, 'X', full_width);	// Top row
+	memset(grown + full_width * (full_height - 1), 'X', full_width);	// Bottom row
+	grown[full_width * full_height] = '\0';
+	free(lengths);
+
+	*cells = grid_create(grown, full_width, full_height);
+	if (!*cells) {
+		fprintf(err, "Memory allocation error");
+		free(grown);
+		return MEMORY_ERROR;
+	}
+	// The ring takes up the first row and column
+	*start = (ends.row[0] + 1) * full_width + ends.col[0] + 1;
+	*finish = (ends.row[1] + 1) * full_width + ends.col[1] + 1;
+	return SUCCESS;
+}
+
+int map_maze(FILE * fo, const char *valid_set, grid ** cells,
+	     unsigned char **open, size_t *start, size_t *finish, FILE * err)
+{
+	bool allowed[UCHAR_MAX + 1];
+	allow_symbols(valid_set, allowed);
+
+	*cells = grid_map(fileno(fo));
+	if (!*cells) {
+		fprintf(err, "Could not map maze file: %s\n", strerror(errno));
+		return FILE_ERROR;
+	}
+
+	// The walls are noted on the way through, so that the flood fill need
+	// not read the mapping again; cells past the end of a line are open
+	size_t width = grid_width(*cells);
+	size_t bytes = width * grid_height(*cells) / CHAR_BIT + 1;
+	*open = malloc(bytes);
+	if (!*open) {
+		fprintf(err, "Memory allocation error");
+		grid_destroy(*cells);
+		return MEMORY_ERROR;
+	}
+	memset(*open, UCHAR_MAX, bytes);
+
+	// Lines are checked where they sit in the mapping
+	struct ends ends = { { false, false }, { 0, 0 }, { 0, 0 } };
+	size_t rows = grid_height(*cells) - 2;
+	size_t scanned = 0;
+	for (size_t row = 0; row < rows; ++row) {
+		const char *line;
+		size_t length = grid_line(*cells, row, &line);
+		if (!scan_line(line, length, allowed, row, &ends, err)) {
+			grid_destroy(*cells);
+			free(*open);
+			*open = NULL;
+			return INVALID_MAP;
+		}
+		// The ring takes up the first row and column
+		for (size_t col = 0; col < length; ++col) {
+			size_t cell = (row + 1) * width + col + 1;
+			if (find_weight(line[col]) <= 0) {
+				(*open)[cell / CHAR_BIT] &= ~(1u << (cell % CHAR_BIT));
+			}
+		}
+		scanned += length;
+		if (scanned >= RELEASE_CELLS) {
+			grid_release(*cells);
+			scanned = 0;
+		}
+	}
+	grid_release(*cells);
+
+	int status = check_ends(&ends, rows, err);
+	if (status != SUCCESS) {
+		grid_destroy(*cells);
+		free(*open);
+		*open = NULL;
+		return status;
+	}
+
+	*start = (ends.row[0] + 1) * width + ends.col[0] + 1;
+	*finish = (ends.row[1] + 1) * width + ends.col[1] + 1;
+	return SUCCESS;
+}
+
+int pack_maze(FILE * fo, const char *valid_set, grid ** cells, size_t *start,
+	      size_t *finish, FILE * err)
+{
+	bool allowed[UCHAR_MAX + 1];
+	allow_symbols(valid_set, allowed);
+
+	// Every symbol the maze may hold gets a 4-bit code, so each line is
+	// packed as soon as it is read and checked
+	*cells = grid_create_packed(valid_set);
+	if (!*cells) {
+		fprintf(err, "Memory allocation error");
+		return MEMORY_ERROR;
+	}
+
+	struct ends ends = { { false, false }, { 0, 0 }, { 0, 0 } };
+	size_t rows = 0;
+	int status = SUCCESS;
+	char *line_buf = NULL;
+	size_t buf_size = 0;
+	ssize_t read;
+	while ((read = getline(&line_buf, &buf_size, fo)) != -1) {
+		size_t length = read;
+		if (length > 0 && line_buf[length - 1] == '\n') {
+			--length;
+		}
+		if (!scan_line(line_buf, length, allowed, rows, &ends, err)) {
+			status = INVALID_MAP;
+			break;
+		}
+		if (!grid_append_line(*cells, line_buf, length)) {
+			fprintf(err, "Memory allocation error");
+			status = MEMORY_ERROR;
+			break;
+		}
+		++rows;
+	}
+	free(line_buf);
+
+	if (status == SUCCESS) {
+		status = check_ends(&ends, rows, err);
+	}
+	if (status != SUCCESS) {
+		grid_destroy(*cells);
+		return status;
+	}
+
+	// The ring takes up the first row and column
+	size_t width = grid_width(*cells);
+	*start = (ends.row[0] + 1) * width + ends.col[0] + 1;
+	*finish = (ends.row[1] + 1) * width + ends.col[1] + 1;
+	return SUCCESS;
+}
+
+void allow_symbols(const char *valid_set, bool allowed[UCHAR_MAX + 1])
+{
+	memset(allowed, false, (UCHAR_MAX + 1) * sizeof(*allowed));
+	for (const char *c = valid_set; *c; ++c) {
+		allowed[(unsigned char)*c] = true;
+	}
+}
+
+bool scan_line(const char *line, size_t length,
+	       const bool allowed[UCHAR_MAX + 1], size_t row,
+	       struct ends *ends, FILE * err)
+{
+	for (size_t col = 0; col < length; ++col) {
+		unsigned char cell = line[col];
+		if (!allowed[cell]) {
+			// Case: found disallowed symbols in maze
+			fprintf(err, "Error: invalid symbol(s) in maze\n");
+			return false;
+		}
+
+		// Only the first start and finish count
+		size_t end = cell == '@' ? 0 : cell == '>' ? 1 : 2;
+		if (end < 2 && !ends->found[end]) {
+			ends->found[end] = true;
+			ends->row[end] = row;
+			ends->col[end] = col;
+		}
+	}
+
+	return true;
+}
+
+int check_ends(const struct ends *ends, size_t rows, FILE * err)
+{
+	if (rows == 0) {
+		// Case: file was empty
+		fprintf(err, "Error: empty file\n");
+		return INVALID_MAP;
+	} else if (!ends->found[0] || !ends->found[1]) {
+		fprintf(err, "Error: maze has no %s\n",
+			ends->found[0] ? "finish" : "start");
+		return INVALID_MAP;
+	}
+
+	return SUCCESS;
+}
+
+unsigned char *open_cells(const grid * cells)
+{
+	size_t count = grid_width(cells) * grid_height(cells);
+	unsigned char *open = malloc(count / CHAR_BIT + 1);
+	if (!open) {
+		return (NULL);
+	}
+
+	memset(open, UCHAR_MAX, count / CHAR_BIT + 1);
+	for (size_t cell = 0; cell < count; ++cell) {
+		if (find_weight(grid_cell(cells, cell)) <= 0) {
+			open[cell / CHAR_BIT] &= ~(1u << (cell % CHAR_BIT));
+		}
+	}
+
+	return (open);
+}
+
+enum reach flood_fill(const grid * cells, unsigned char *open, size_t start,
+		      size_t finish, FILE * err)
+{
+	size_t width = grid_width(cells);
+	size_t count = width * grid_height(cells);
+	// The open bit of each cell is cleared as the flood reaches it, so
+	// that it goes in the queue of cells to visit only once
+	struct cell_queue queue = { NULL, 0, 0, 0 };
+	if (!cell_queue_push(&queue, start)) {
+		fprintf(err, "Memory allocation error");
+		return REACH_UNKNOWN;
+	}
+
+	enum reach reach = FINISH_UNREACHED;
+	open[start / CHAR_BIT] &= ~(1u << (start % CHAR_BIT));
+	while (queue.size) {
+		size_t curr = queue.cells[queue.head];
+		queue.head = (queue.head + 1) & (queue.capacity - 1);
+		queue.size--;
+		if (curr < width || curr >= count - width || curr % width == 0
+		    || curr % width == width - 1) {
+			// The maze itself may hold 'X' cells; only the ring
+			// around it means the start has walked out
+			reach = UNBOUNDED;
+			break;
+		} else if (curr == finish) {
+			reach = FINISH_REACHED;
+		}
+		// The search stops at the edge of the buffer, so every neighbor
+		// here is in bounds
+		size_t nbrs[4] = { curr + width, curr + 1, curr - width, curr - 1 };
+		for (size_t n = 0; n < 4; ++n) {
+			size_t nbr = nbrs[n];
+			if (!(open[nbr / CHAR_BIT] & (1u << (nbr % CHAR_BIT)))) {
+				continue;
+			}
+			open[nbr / CHAR_BIT] &= ~(1u << (nbr % CHAR_BIT));
+			if (!cell_queue_push(&queue, nbr)) {
+				fprintf(err, "Memory allocation error");
+				reach = REACH_UNKNOWN;
+				queue.size = 0;
+				break;
+			}
+		}
+	}
+
+	free(queue.cells);
+	return (reach);
+}
+
+bool cell_queue_push(struct cell_queue *q, size_t cell)
+{
+	if (q->size == q->capacity) {
+		size_t capacity = q->capacity ? 2 * q->capacity : CELL_QUEUE_START;
+		size_t *bigger = malloc(capacity * sizeof(*bigger));
+		if (!bigger) {
+			return (false);
+		}
+		// Unwrapped, oldest first
+		for (size_t n = 0; n < q->size; ++n) {
+			bigger[n] = q->cells[(q->head + n) & (q->capacity - 1)];
+		}
+		free(q->cells);
+		q->cells = bigger;
+		q->head = 0;
+		q->capacity = capacity;
+	}
+
+	q->cells[(q->head + q->size) & (q->capacity - 1)] = cell;
+	q->size++;
+	return (true);
 }
 
 double find_weight(char target)
@@ -219,26 +1120,35 @@ double find_weight(char target)
 	return 0;
 }
 
-void dimensions_of_maze(FILE * fo, int *height, int *width)
+double cheapest_weight(const char *symbols)
 {
-	// Height and width start at 2, because there is a box of 'X's
-	// representing boundary nodes that rings the entire maze.
-	*height = 2;
-	*width = 2;
-
-	char *line_buf = NULL;
-	size_t buf_size = 0;
-	while (getline(&line_buf, &buf_size, fo) != -1) {
-		strtok(line_buf, "\n");
-		// Width will never be negative, this is a safe cast
-		if (strlen(line_buf) > (unsigned)*width - 2) {
-			*width = strlen(line_buf) + 2;
+	double cheapest = 0;
+	for (const char *c = symbols; *c; ++c) {
+		// Walls cannot be crossed; 'X' cells inside the maze can, and
+		// are the cheapest of all
+		if (find_weight(*c) <= 0) {
+			continue;
+		}
+		if (cheapest <= 0 || find_weight(*c) < cheapest) {
+			cheapest = find_weight(*c);
 		}
-		++*height;
-	}
-	if (line_buf) {
-		free(line_buf);
 	}
-	// Reset file pointer position
-	fseek(fo, 0, SEEK_SET);
+
+	return cheapest;
+}
+
+double manhattan_estimate(const void *from, const void *to, void *arg)
+{
+	const struct estimate_info *info = arg;
+	size_t a = (size_t)from;
+	size_t b = (size_t)to;
+
+	size_t rows = a / info->width > b / info->width ?
+	    a / info->width - b / info->width : b / info->width - a / info->width;
+	size_t cols = a % info->width > b % info->width ?
+	    a % info->width - b % info->width : b % info->width - a % info->width;
+
+	// Every step moves one row or column and costs at least min_weight,
+	// so this never overestimates
+	return (rows + cols) * info->min_weight;
 }
@@ -115,8 +115,8 @@ EXPECTED_OUTPUT="######################
 #  > ####   ##@.....#  
 # .. ##     #######.###
 ##.#### #   ### .... ##
- #.#### #######..### ##
- #.####......... ### ##
+ #.#### ####### .### ##
+ #.####..........### ##
  #......######       ##
 #####################  "
 $PROGRAM $OPTIONS ${FILES[@]} > output.txt
@@ -136,8 +136,8 @@ EXPECTED_OUTPUT="#######################
 #  > ####   ##@.....###
 # .. ##     #######.###
 ##.#### #   ### .... ##
-##.#### #######..### ##
-##.####......... ### ##
+##.#### ####### .### ##
+##.####..........### ##
 ##......######       ##
 #######################"
 $PROGRAM $OPTIONS ${FILES[@]} > output.txt
@@ -157,11 +157,11 @@ EXPECTED_OUTPUT="###############################################################
 #   ############################################################       #########
 # > #######      ##########       #########   ##################       #########
 # . #######           #####      .....#####   ###                              #
-##.########      #### #####     ..###.#####   ###    ###########       ####### #
-##.########      ####       ..... ###.#####   ###    ######################### #
-##.########      ########## .     ###.#####   ###    ######################### #
-##.######################## .     ###.####### ###    #######  .............### #
-##.#########################.########.####### ##############  .     ######.....#
+##.########      #### #####      .###.#####   ###    ###########       ####### #
+##.########      ####            .###.#####   ###    ######################### #
+##.########      ##########      .###.#####   ###    ######################### #
+##.######################## ......###.####### ###    #######       ........### #
+##.#########################.########.####### ##############  ......######.....#
 ##.#########################.####.....####### ################.###############.#
 ##..........################.####.########### ################.###############.#
 ###########.##########    ##.####.########### ######          .#    @ ########.#
@@ -171,9 +171,9 @@ EXPECTED_OUTPUT="###############################################################
 ###########.################.####.##       ## ######      ####.#    . ########.#
 ########   ...##############.####.##       ## ################.#    . ########.#
 ########     ................####.##       ## ################.#    . ########.#
-####   #      ###################.##########...................#   .. ########.#
-####   ### #######           ####.##########.###################   .  ########.#
-###### ### ####### #########     .##########.##      ###########  ..  ########.#
+####   #      ###################.##########...................#    . ########.#
+####   ### #######           ####.##########.###################    . ########.#
+###### ### ####### #########     .##########.##      ###########  ... ########.#
 ######     ####### ##############..........#.##      #############.###########.#
 #################      ###################...        #############.###########.#
 #################      ###########################################.............#
@@ -195,20 +195,20 @@ FILES="./samp/map03.txt"
 OPTIONS=""
 EXPECTED_OUTPUT="############################################################################# 
 #   #########################################################       ######### 
-# >.........     ##########       ######   ##################       ######### 
-#   #######...........#####      ......... ###   ...........................##
-###########      ####.#####     ..### ## ..###   .###########       #######..#
-###########      ####............ ### ##  ........##########################.#
+# >..............##########       ######   ##################       ######### 
+#   #######     ......#####      ..........###   ...........................##
+###########      ####.#####      .### ##  .###   .###########       #######..#
+###########      ####.............### ##  ........##########################.#
 ###########      #######################   ###    ##########################.#
-########################### ......### ########    #######  .............###..#
-##.........................#.####.### #### ##############...     ######.....# 
+########################### ......### ########    #######       ........###..#
+##.........................#.####.### #### ##############........######.....# 
 ##.#######################...####.........................# ############### # 
-##..        ################################################################# 
-## ........ #                                                                 
-##        ..#                                                                 
+##..........################################################################# 
+##         .#                                                                 
+##         .#                                                                 
 ##         .################################################################# 
-###########.##########    ## ####       ## ######          ...     ######## # 
-###########.##########       #### ##    ## ######      ####.#...   ######## # 
+###########.##########    ## ####       ## ######          .....   ######## # 
+###########.##########       #### ##    ## ######      ####.#  .   ######## # 
 ###########.################ #### ##    ## ######      ####.#  .   ######## # 
 ########   .  ############## #### ##    ## ################.#  .   ######## # 
 ########   .                 #### ##    ## ################.#  .   ######## # 
@@ -249,11 +249,11 @@ fi
 FILES="./samp/water.txt"
 OPTIONS="-w"
 EXPECTED_OUTPUT="############
-# ....>    #
-#..       ~#
+#     >    #
+#......   ~#
 #.########~#
-#..      ~~#
-# .....@ ~~#
+#....... ~~#
+#      @ ~~#
 ############
 "
 
@@ -299,6 +299,307 @@ else
     echo -e "14. Door w/ option test                : ${RED}FAIL${NC}"
 fi
 
+# Test 15: program solves mazes with A* search
+
+FILES="./samp/map02.txt"
+OPTIONS="-a"
+EXPECTED_OUTPUT="################################################################################
+#   ############################################################       #########
+# > #######      ##########       #########   ##################       #########
+# . #######           ##### ..........#####   ###                              #
+##.########      #### ##### .     ###.#####   ###    ###########       ####### #
+##.########      ####       .     ###.#####   ###    ######################### #
+##.########      ########## .     ###.#####   ###    ######################### #
+##.######################## .     ###.####### ###    #######  .............### #
+##.#########################.########.####### ##############  .     ######.....#
+##.#########################.####.....####### ################.###############.#
+##..........################.####.########### ################.###############.#
+###########.##########    ##.####.########### ######          .#  ..@ ########.#
+###########.##########    ##.####.########### ###### #########.#  .   ########.#
+###########.##########    ##.####.         ## ######      ####.#  .   ########.#
+###########.##########      .####.##       ## ######      ####.#  .   ########.#
+###########.################.####.##       ## ######      ####.#  .   ########.#
+########   ...##############.####.##       ## ################.#  .   ########.#
+########     ................####.##       ## ################.#  .   ########.#
+####   #      ###################.##########...................#  .   ########.#
+####   ### #######           ####.##########.###################  .   ########.#
+###### ### ####### #########     .##########.##      ###########  .   ########.#
+######     ####### ##############..........#.##      #############.###########.#
+#################      ###################...        #############.###########.#
+#################      ###########################################.............#
+################################################################################
+"
+
+$PROGRAM $OPTIONS ${FILES[@]} > output.txt
+
+# Expected: Program solves maze and exits with code 0 for SUCCESS
+if [ $? -eq 0 ] && grep -q "$EXPECTED_OUTPUT" output.txt; then
+    echo -e "15. A* search test                     : ${GREEN}PASS${NC}"
+else
+    echo -e "15. A* search test                     : ${RED}FAIL${NC}"
+fi
+
+# Test 16: program solves mazes searching from both ends
+
+FILES="./samp/map01.txt"
+OPTIONS="-b"
+EXPECTED_OUTPUT="#######################
+#  > ####   ##@.....###
+# .. ##     #######.###
+##.#### #   ### .... ##
+##.#### ####### .### ##
+##.####..........### ##
+##......######       ##
+#######################
+"
+
+$PROGRAM $OPTIONS ${FILES[@]} > output.txt
+
+# Expected: Program solves maze and exits with code 0 for SUCCESS
+if [ $? -eq 0 ] && grep -q "$EXPECTED_OUTPUT" output.txt; then
+    echo -e "16. Bidirectional search test          : ${GREEN}PASS${NC}"
+else
+    echo -e "16. Bidirectional search test          : ${RED}FAIL${NC}"
+fi
+
+# Test 17: program rejects a maze with nowhere to start
+
+FILES="./samp/no_start.txt"
+OPTIONS=""
+EXPECTED_OUTPUT="Error: maze has no start"
+$PROGRAM $OPTIONS ${FILES[@]} 2> output.txt
+
+# Expected: Program prints error message and exits with code 4 for INVALID_MAP
+if [ $? -eq 4 ] && grep -q "$EXPECTED_OUTPUT" output.txt; then
+    echo -e "17. Missing start test                 : ${GREEN}PASS${NC}"
+else
+    echo -e "17. Missing start test                 : ${RED}FAIL${NC}"
+fi
+
+# Test 18: program solves mazes read in place from a mapped file
+
+FILES="./samp/map03.txt"
+OPTIONS="-m"
+EXPECTED_OUTPUT="############################################################################# 
+#   #########################################################       ######### 
+# >..............##########       ######   ##################       ######### 
+#   #######     ......#####      ..........###   ...........................##
+###########      ####.#####      .### ##  .###   .###########       #######..#
+###########      ####.............### ##  ........##########################.#
+###########      #######################   ###    ##########################.#
+########################### ......### ########    #######       ........###..#
+##.........................#.####.### #### ##############........######.....# 
+##.#######################...####.........................# ############### # 
+##..........################################################################# 
+##         .#                                                                 
+##         .#                                                                 
+##         .################################################################# 
+###########.##########    ## ####       ## ######          .....   ######## # 
+###########.##########       #### ##    ## ######      ####.#  .   ######## # 
+###########.################ #### ##    ## ######      ####.#  .   ######## # 
+########   .  ############## #### ##    ## ################.#  .   ######## # 
+########   .                 #### ##    ## ################.#  .   ######## # 
+####   #  ..  ################### #######...................#  .   ######## # 
+####   ###.#######...........#### #######.###################  .   ######## # 
+###### ###.#######.#########......#######.##      ###########  .   ######## # 
+######    .#######.##############.......#.##      #############.########### # 
+##########.........    ################...        #############....@        # 
+############################################################################# 
+"
+
+$PROGRAM $OPTIONS ${FILES[@]} > output.txt
+
+# Expected: Program solves maze and exits with code 0 for SUCCESS
+if [ $? -eq 0 ] && grep -q "$EXPECTED_OUTPUT" output.txt; then
+    echo -e "18. Mapped input test                  : ${GREEN}PASS${NC}"
+else
+    echo -e "18. Mapped input test                  : ${RED}FAIL${NC}"
+fi
+
+# Test 19: program solves several mazes at once, in order
+
+FILES="./samp/map00.txt ./samp/empty.txt ./samp/map01.txt"
+OPTIONS="-j 2"
+EXPECTED_OUTPUT="==> ./samp/map00.txt [0] <==
+==> ./samp/empty.txt [4] <==
+==> ./samp/map01.txt [0] <=="
+
+$PROGRAM $OPTIONS ${FILES[@]} > output.txt 2> /dev/null
+
+# Expected: Program solves each maze, heads each one with its status, and
+# exits with the first failing code, 4 for INVALID_MAP
+if [ $? -eq 4 ] && [ "$(grep "^==>" output.txt)" == "$EXPECTED_OUTPUT" ]; then
+    echo -e "19. Batch test                         : ${GREEN}PASS${NC}"
+else
+    echo -e "19. Batch test                         : ${RED}FAIL${NC}"
+fi
+
+# Test 20: program solves mazes kept packed in 4 bits a cell
+
+FILES="./samp/map02.txt"
+OPTIONS="-c -dw"
+EXPECTED_OUTPUT="################################################################################
+#   ############################################################       #########
+# > #######      ##########       #########   ##################       #########
+# . #######           #####      .....#####   ###                              #
+##.########      #### #####      .###.#####   ###    ###########       ####### #
+##.########      ####            .###.#####   ###    ######################### #
+##.########      ##########      .###.#####   ###    ######################### #
+##.######################## ......###.####### ###    #######       ........### #
+##.#########################.########.####### ##############  ......######.....#
+##.#########################.####.....####### ################.###############.#
+##..........################.####.########### ################.###############.#
+###########.##########    ##.####.########### ######          .#    @ ########.#
+###########.##########    ##.####.########### ###### #########.#    . ########.#
+###########.##########    ##.####.         ## ######      ####.#    . ########.#
+###########.##########      .####.##       ## ######      ####.#    . ########.#
+###########.################.####.##       ## ######      ####.#    . ########.#
+########   ...##############.####.##       ## ################.#    . ########.#
+########     ................####.##       ## ################.#    . ########.#
+####   #      ###################.##########...................#    . ########.#
+####   ### #######           ####.##########.###################    . ########.#
+###### ### ####### #########     .##########.##      ###########  ... ########.#
+######     ####### ##############..........#.##      #############.###########.#
+#################      ###################...        #############.###########.#
+#################      ###########################################.............#
+################################################################################
+"
+
+$PROGRAM $OPTIONS ${FILES[@]} > output.txt
+
+# Expected: Program solves maze and exits with code 0 for SUCCESS
+if [ $? -eq 0 ] && grep -q "$EXPECTED_OUTPUT" output.txt; then
+    echo -e "20. Packed maze test                   : ${GREEN}PASS${NC}"
+else
+    echo -e "20. Packed maze test                   : ${RED}FAIL${NC}"
+fi
+
+# Test 21: program solves mazes jumping across open stretches
+
+FILES="./samp/door.txt"
+OPTIONS="-J -d"
+EXPECTED_OUTPUT="#######
+#.....#
+#@+++>#
+#######"
+
+$PROGRAM $OPTIONS ${FILES[@]} > output.txt
+
+# Expected: Program finds the same cheapest path around the doors and exits
+# with code 0 for SUCCESS
+if [ $? -eq 0 ] && grep -q "$EXPECTED_OUTPUT" output.txt; then
+    echo -e "21. Jump point search test             : ${GREEN}PASS${NC}"
+else
+    echo -e "21. Jump point search test             : ${RED}FAIL${NC}"
+fi
+
+# Test 22: program solves mazes with several threads sharing the search
+
+FILES="./samp/door.txt"
+OPTIONS="-t 3 -d"
+EXPECTED_OUTPUT="#######
+#.....#
+#@+++>#
+#######"
+
+$PROGRAM $OPTIONS ${FILES[@]} > output.txt
+
+# Expected: Program finds the same cheapest path around the doors and exits
+# with code 0 for SUCCESS
+if [ $? -eq 0 ] && grep -q "$EXPECTED_OUTPUT" output.txt; then
+    echo -e "22. Delta-stepping test                : ${GREEN}PASS${NC}"
+else
+    echo -e "22. Delta-stepping test                : ${RED}FAIL${NC}"
+fi
+
+# Test 23: program reports what the search took
+
+FILES="./samp/basic_maze.txt"
+OPTIONS="-s"
+EXPECTED_OUTPUT="Nodes expanded: [1-9]"
+
+$PROGRAM $OPTIONS ${FILES[@]} 2> output.txt > /dev/null
+
+# Expected: Program solves maze, reports the nodes it expanded and its peak
+# memory on stderr, and exits with code 0 for SUCCESS
+if [ $? -eq 0 ] && grep -q "$EXPECTED_OUTPUT" output.txt \
+        && grep -q "^Peak memory: [0-9]* KiB$" output.txt; then
+    echo -e "23. Search stats test                  : ${GREEN}PASS${NC}"
+else
+    echo -e "23. Search stats test                  : ${RED}FAIL${NC}"
+fi
+
+# Test 24: program reports search stats as JSON
+
+FILES="./samp/basic_maze.txt"
+OPTIONS="--stats=json"
+EXPECTED_OUTPUT='^{"seconds": {"load": [0-9.]*, .*"peak_rss_kib": [0-9]*, "path_cost": [0-9.]*}$'
+
+$PROGRAM $OPTIONS ${FILES[@]} 2> output.txt > /dev/null
+
+# Expected: Program solves maze, prints one JSON object of stats on stderr,
+# and exits with code 0 for SUCCESS
+if [ $? -eq 0 ] && grep -q "$EXPECTED_OUTPUT" output.txt; then
+    echo -e "24. JSON search stats test             : ${GREEN}PASS${NC}"
+else
+    echo -e "24. JSON search stats test             : ${RED}FAIL${NC}"
+fi
+
+# Test 25: path trees give paths as cheap as Dijkstra's
+
+FILES="./samp/basic_maze.txt ./samp/door.txt ./samp/map00.txt ./samp/map01.txt
+./samp/map02.txt ./samp/map03.txt ./samp/no_solution.txt ./samp/water.txt
+./samp/x_shortcut.txt"
+OPTIONS="-T -dw -s"
+EXPECTED_OUTPUT="^Path cost: [0-9.]*$"
+
+SAME=yes
+for FILE in $FILES; do
+    $PROGRAM -dw -s $FILE 2> expected.txt > /dev/null
+    $PROGRAM $OPTIONS $FILE 2> output.txt > /dev/null
+    if [ $? -ne 0 ] || [ "$(grep "^Path cost:" expected.txt)" != \
+            "$(grep "^Path cost:" output.txt)" ]; then
+        SAME=no
+    fi
+done
+
+# Expected: Program reads each path off a path tree at just the cost plain
+# Dijkstra finds, none where there is no path, and exits with code 0 for
+# SUCCESS
+if [ $SAME = yes ] && grep -q "$EXPECTED_OUTPUT" expected.txt; then
+    echo -e "25. Path tree test                     : ${GREEN}PASS${NC}"
+else
+    echo -e "25. Path tree test                     : ${RED}FAIL${NC}"
+fi
+
+# Test 26: A* and jump point search stay exact across the cheap 'X' cells
+# inside a maze
+
+FILES="./samp/x_shortcut.txt"
+EXPECTED_OUTPUT="###########
+#@       >#
+#.#######.#
+#.........#
+###########"
+
+$PROGRAM ${FILES[@]} > expected.txt
+SAME=yes
+for OPTIONS in "-a" "-J"; do
+    $PROGRAM $OPTIONS ${FILES[@]} > output.txt
+    if [ $? -ne 0 ] || ! cmp -s expected.txt output.txt; then
+        SAME=no
+    fi
+done
+
+# Expected: Program takes the long way round through the 'X' cells with
+# either heuristic solver, as plain Dijkstra does, and exits with code 0
+# for SUCCESS
+if [ $SAME = yes ] && grep -q "$EXPECTED_OUTPUT" output.txt; then
+    echo -e "26. Heuristic 'X' shortcut test        : ${GREEN}PASS${NC}"
+else
+    echo -e "26. Heuristic 'X' shortcut test        : ${RED}FAIL${NC}"
+fi
+
 # Cleanup temp files
-rm output.txt
+rm output.txt expected.txt
 